@@ -0,0 +1,84 @@
+#!/usr/bin/env bash
+# Сравнивает пропускную способность game_server в режиме общего io_context и в режиме
+# --per-core. Оба режима получают одинаковую открытую нагрузку от loadgen и одинаковую
+# привязку потоков к ядрам, так что различается только раскладка io_context. Отчёты и
+# описание машины сохраняются в каталог результатов.
+#
+# Использование (из каталога сборки):
+#   ../benchmarks/compare_io_modes.sh [профиль] [каталог результатов]
+# Переменные окружения: GAME_SERVER, LOADGEN - пути к бинарникам, CONNECTIONS, THREADS -
+# параметры loadgen, PIN_THREADS=0 - не привязывать потоки сервера к ядрам ни в одном
+# из режимов. Сервер слушает порт 8080.
+set -euo pipefail
+
+SOLUTION_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+PROFILE="${1:-line(100, 20000, 30s) const(20000, 30s)}"
+OUT_DIR="${2:-io-modes-$(date +%Y%m%d-%H%M%S)}"
+GAME_SERVER="${GAME_SERVER:-./game_server}"
+LOADGEN="${LOADGEN:-./loadgen}"
+CONNECTIONS="${CONNECTIONS:-64}"
+THREADS="${THREADS:-2}"
+PIN_THREADS="${PIN_THREADS:-1}"
+
+PIN_ARGS=()
+if [[ "$PIN_THREADS" == 1 ]]; then
+    PIN_ARGS=(--pin-threads)
+fi
+
+mkdir -p "$OUT_DIR"
+
+# Описание машины: без него результаты разных запусков несравнимы
+{
+    echo "date: $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+    echo "kernel: $(uname -srm)"
+    echo "cpus: $(nproc)"
+    grep -m1 "model name" /proc/cpuinfo || true
+    echo "profile: $PROFILE"
+    echo "loadgen: --connections $CONNECTIONS --threads $THREADS"
+    echo "server: ${PIN_ARGS[*]:-no pinning}"
+} > "$OUT_DIR/machine.txt"
+
+# Патроны: keep-alive запросы к API и статике, без Connection: close
+AMMO="$OUT_DIR/ammo.txt"
+cat > "$AMMO" <<AMMO_EOF
+[Host: 127.0.0.1:8080]
+/api/v1/maps maps
+/api/v1/maps/map1 map
+/index.html static
+AMMO_EOF
+
+SERVER_PID=
+stop_server() {
+    if [[ -n "$SERVER_PID" ]]; then
+        kill -INT "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        SERVER_PID=
+    fi
+}
+trap stop_server EXIT
+
+run_mode() {
+    local name="$1"
+    shift
+    "$GAME_SERVER" "$SOLUTION_DIR/data/config.json" "$SOLUTION_DIR/static" "$@" \
+        > "$OUT_DIR/$name-server.log" 2>&1 &
+    SERVER_PID=$!
+    # Ждём, пока сервер начнёт принимать соединения
+    for _ in $(seq 50); do
+        if (echo > "/dev/tcp/127.0.0.1/8080") 2>/dev/null; then
+            break
+        fi
+        sleep 0.1
+    done
+    "$LOADGEN" "127.0.0.1:8080" "$AMMO" "$PROFILE" --connections "$CONNECTIONS" \
+        --threads "$THREADS" --output "$OUT_DIR/$name.json"
+    stop_server
+    # Краткая сводка: пропускная способность и хвост задержки
+    echo "$name: $(grep -o '"throughput_rps":[0-9.]*' "$OUT_DIR/$name.json")" \
+        "$(grep -o '"p99":[0-9.]*' "$OUT_DIR/$name.json" | head -1)" \
+        "$(grep -o '"unsent":[0-9]*' "$OUT_DIR/$name.json")"
+}
+
+cat "$OUT_DIR/machine.txt"
+run_mode shared "${PIN_ARGS[@]}"
+run_mode per-core --per-core "${PIN_ARGS[@]}"
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Считает вызовы malloc на один keep-alive запрос к game_server.
+
+Сервер запускается дважды под malloc_counter.so: в первый раз получает
+WARM_UP запросов, во второй - WARM_UP + requests. Разница счётчиков,
+делённая на requests, не включает выделения при запуске и остановке.
+
+Использование (из каталога сборки):
+    gcc -O2 -shared -fPIC -o malloc_counter.so ../benchmarks/malloc_counter.c -ldl
+    ../benchmarks/count_mallocs.py ./game_server ./malloc_counter.so /api/v1/maps/map1
+"""
+import argparse
+import os
+import re
+import signal
+import socket
+import subprocess
+import time
+
+SOLUTION_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PORT = 8080
+WARM_UP = 10
+
+
+def wait_for_port(timeout=10.0):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            socket.create_connection(('127.0.0.1', PORT)).close()
+            return
+        except OSError:
+            time.sleep(0.1)
+    raise RuntimeError('game_server did not start listening on port %d' % PORT)
+
+
+def send_requests(path, count):
+    """Отправляет count запросов по одному соединению и дочитывает каждый ответ."""
+    request = ('GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: */*\r\n'
+               'Accept-Encoding: gzip, br\r\n\r\n' % path).encode()
+    with socket.create_connection(('127.0.0.1', PORT)) as sock:
+        buffer = b''
+        for _ in range(count):
+            sock.sendall(request)
+            while b'\r\n\r\n' not in buffer:
+                buffer += sock.recv(65536)
+            head, buffer = buffer.split(b'\r\n\r\n', 1)
+            length = int(re.search(rb'(?im)^content-length:\s*(\d+)', head).group(1))
+            while len(buffer) < length:
+                buffer += sock.recv(65536)
+            buffer = buffer[length:]
+
+
+def count_mallocs(server, counter, path, count):
+    env = dict(os.environ, LD_PRELOAD=os.path.abspath(counter))
+    process = subprocess.Popen(
+        [server, os.path.join(SOLUTION_DIR, 'data', 'config.json'), os.path.join(SOLUTION_DIR, 'static')],
+        env=env, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    try:
+        wait_for_port()
+        send_requests(path, count)
+    finally:
+        # Повторный сигнал останавливает сервер, не дожидаясь плавной остановки
+        process.send_signal(signal.SIGINT)
+        time.sleep(0.2)
+        if process.poll() is None:
+            process.send_signal(signal.SIGINT)
+        _, stderr = process.communicate()
+    match = re.search(rb'MALLOC_COUNT (\d+)', stderr)
+    if not match:
+        raise RuntimeError('malloc counter did not report, is LD_PRELOAD applied?')
+    return int(match.group(1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('server', help='путь к game_server')
+    parser.add_argument('counter', help='путь к malloc_counter.so')
+    parser.add_argument('path', help='запрашиваемый путь, например /api/v1/maps/map1')
+    parser.add_argument('--requests', type=int, default=2000, help='число измеряемых запросов')
+    args = parser.parse_args()
+
+    base = count_mallocs(args.server, args.counter, args.path, WARM_UP)
+    total = count_mallocs(args.server, args.counter, args.path, WARM_UP + args.requests)
+    print('%s: %.1f mallocs/request' % (args.path, (total - base) / args.requests))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,221 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+
+#include "../src/arena_allocator.h"
+#include "../src/json_loader.h"
+#include "../src/metrics.h"
+#include "../src/request_handler.h"
+
+using namespace std::literals;
+namespace {
+
+namespace fs = std::filesystem;
+namespace http = boost::beast::http;
+
+std::atomic<std::size_t> allocations{0};
+
+void* CountedAllocate(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    return CountedAllocate(size);
+}
+void* operator new[](std::size_t size) {
+    return CountedAllocate(size);
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+constexpr int LARGE_MAP_ROADS = 10'000;
+
+void WriteFile(const fs::path& path, std::string_view content) {
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+// Конфигурация с маленькой картой и картой из LARGE_MAP_ROADS дорог
+std::string MakeConfig() {
+    std::string config = R"({"maps":[{"id":"small","name":"Small","roads":[{"x0":0,"y0":0,"x1":40},)"
+                         R"({"x0":40,"y0":0,"y1":30},{"x0":40,"y0":30,"x1":0},{"x0":0,"y0":0,"y1":30}],)"
+                         R"("buildings":[{"x":5,"y":5,"w":30,"h":20}],)"
+                         R"("offices":[{"id":"o0","x":40,"y":30,"offsetX":5,"offsetY":0}]},)"
+                         R"({"id":"large","name":"Large","roads":[)";
+    for (int i = 0; i < LARGE_MAP_ROADS; ++i) {
+        config += i == 0 ? "" : ",";
+        config += i % 2 == 0 ? R"({"x0":0,"y0":)" + std::to_string(i) + R"(,"x1":1000})"
+                             : R"({"x0":)" + std::to_string(i) + R"(,"y0":0,"y1":1000})";
+    }
+    config += R"(],"buildings":[],"offices":[]}]})";
+    return config;
+}
+
+// Игра, каталог статики и обработчик запросов, общие для всех бенчмарков
+struct Environment {
+    Environment()
+        : root(fs::temp_directory_path() / ("game_server_bench_" + std::to_string(::getpid())))
+        , game(Load(root))
+        , metrics(std::vector<std::string>(http_handler::RequestHandler::ROUTE_NAMES.begin(),
+                                           http_handler::RequestHandler::ROUTE_NAMES.end()))
+        , handler(game, metrics, (root / "static").string()) {
+        // Файл, появившийся после запуска, отдаётся с диска, минуя кеш
+        WriteFile(root / "static" / "uncached.txt", std::string(4096, 'u'));
+    }
+
+    ~Environment() {
+        std::error_code ignored;
+        fs::remove_all(root, ignored);
+    }
+
+    static model::Game Load(const fs::path& root) {
+        fs::create_directories(root / "static");
+        WriteFile(root / "config.json", MakeConfig());
+        std::string html = "<!DOCTYPE html><html><head><title>Game</title></head><body>";
+        while (html.size() < 4096) {
+            html += "<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit.</p>";
+        }
+        html += "</body></html>";
+        WriteFile(root / "static" / "index.html", html);
+        return json_loader::LoadGame(root / "config.json");
+    }
+
+    fs::path root;
+    model::Game game;
+    http_server::Metrics metrics;
+    http_handler::RequestHandler handler;
+};
+
+Environment& GetEnvironment() {
+    static Environment environment;
+    return environment;
+}
+
+struct RequestSpec {
+    http::verb method = http::verb::get;
+    std::string_view target = {};
+    std::string_view accept_encoding = {};
+    // Запрос с If-None-Match, совпадающим с ETag ответа
+    bool conditional = false;
+};
+
+using RequestAllocator = http_server::ArenaAllocator<char>;
+using Request = http::request<http::basic_string_body<char, std::char_traits<char>, RequestAllocator>,
+                              http::basic_fields<RequestAllocator>>;
+
+// Запрос размещается в арене, как в сессии сервера, поэтому его разбор не влияет на allocs/op
+Request MakeRequest(std::pmr::memory_resource& arena, const RequestSpec& spec, std::string_view etag) {
+    const RequestAllocator allocator{&arena};
+    Request request{std::piecewise_construct, std::make_tuple(allocator), std::make_tuple(allocator)};
+    request.method(spec.method);
+    request.target(spec.target);
+    request.version(11);
+    request.set(http::field::host, "localhost:8080"sv);
+    request.set(http::field::user_agent, "game_server_bench"sv);
+    if (!spec.accept_encoding.empty()) {
+        request.set(http::field::accept_encoding, spec.accept_encoding);
+    }
+    if (!etag.empty()) {
+        request.set(http::field::if_none_match, etag);
+    }
+    return request;
+}
+
+// Send, который запоминает код ответа и его ETag, не сериализуя ответ
+struct CapturingSend {
+    template <typename Response>
+    void operator()(Response&& response) {
+        status = response.result_int();
+        if (capture_etag) {
+            etag = response[http::field::etag];
+        }
+        benchmark::DoNotOptimize(response);
+    }
+
+    unsigned status = 0;
+    bool capture_etag = false;
+    std::string etag;
+};
+
+void BM_Request(benchmark::State& state, RequestSpec spec) {
+    auto& handler = GetEnvironment().handler;
+    std::array<std::byte, 4096> arena_buffer;
+
+    CapturingSend send;
+    if (spec.conditional) {
+        // ETag берётся из безусловного ответа на тот же запрос
+        std::pmr::monotonic_buffer_resource arena{arena_buffer.data(), arena_buffer.size()};
+        send.capture_etag = true;
+        handler(MakeRequest(arena, spec, {}), send);
+        send.capture_etag = false;
+    }
+    const std::string etag = std::move(send.etag);
+
+    const std::size_t allocations_before = allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        std::pmr::monotonic_buffer_resource arena{arena_buffer.data(), arena_buffer.size()};
+        handler(MakeRequest(arena, spec, etag), send);
+    }
+    const std::size_t allocated = allocations.load(std::memory_order_relaxed) - allocations_before;
+    state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(allocated), benchmark::Counter::kAvgIterations);
+    state.SetLabel("status " + std::to_string(send.status));
+}
+
+}  // namespace
+
+// Карты: ответ ссылается на JSON, подготовленный при загрузке, поэтому время не зависит от размера карты
+BENCHMARK_CAPTURE(BM_Request, maps_list, RequestSpec{.target = "/api/v1/maps"});
+BENCHMARK_CAPTURE(BM_Request, map_small, RequestSpec{.target = "/api/v1/maps/small"});
+BENCHMARK_CAPTURE(BM_Request, map_10k_roads, RequestSpec{.target = "/api/v1/maps/large"});
+BENCHMARK_CAPTURE(BM_Request, map_not_modified, RequestSpec{.target = "/api/v1/maps/small", .conditional = true});
+
+// Статика: файл из кеша (со сжатием и без), повторный запрос с If-None-Match,
+// файл с диска вне кеша и отсутствующий файл
+BENCHMARK_CAPTURE(BM_Request, static_hit, RequestSpec{.target = "/index.html"});
+BENCHMARK_CAPTURE(BM_Request, static_hit_gzip, RequestSpec{.target = "/index.html", .accept_encoding = "gzip, br"});
+BENCHMARK_CAPTURE(BM_Request, static_not_modified, RequestSpec{.target = "/index.html", .conditional = true});
+BENCHMARK_CAPTURE(BM_Request, static_uncached, RequestSpec{.target = "/uncached.txt"});
+BENCHMARK_CAPTURE(BM_Request, static_miss, RequestSpec{.target = "/missing.html"});
+
+// Пути, в которых закодирован каждый символ
+BENCHMARK_CAPTURE(BM_Request, url_decode_hit, RequestSpec{.target = "/%69%6E%64%65%78%2E%68%74%6D%6C"});
+BENCHMARK_CAPTURE(BM_Request, url_decode_long_miss,
+                  RequestSpec{.target = "/%D0%B8%D0%B3%D1%80%D0%B0/%D0%BA%D0%B0%D1%80%D1%82%D0%B0/"
+                                        "%D1%81%D0%BB%D0%B8%D1%88%D0%BA%D0%BE%D0%BC/%D0%B4%D0%BB%D0%B8%D0%BD"
+                                        "%D0%BD%D1%8B%D0%B9/%D0%BF%D1%83%D1%82%D1%8C/%D0%BA/%D1%84%D0%B0%D0%B9"
+                                        "%D0%BB%D1%83/%D1%81%D0%BE%20%D1%81%D0%BB%D0%B5%D1%88%D0%B0%D0%BC%D0%B8"
+                                        "/file%20name%20with%20spaces%2Bplus.html"});
+
+// Ошибки
+BENCHMARK_CAPTURE(BM_Request, bad_api_request, RequestSpec{.target = "/api/v1/unknown"});
+BENCHMARK_CAPTURE(BM_Request, map_not_found, RequestSpec{.target = "/api/v1/maps/unknown"});
+BENCHMARK_CAPTURE(BM_Request, api_wrong_method, RequestSpec{.method = http::verb::post, .target = "/api/v1/maps"});
+BENCHMARK_CAPTURE(BM_Request, static_wrong_method, RequestSpec{.method = http::verb::post, .target = "/index.html"});
+BENCHMARK_CAPTURE(BM_Request, path_traversal, RequestSpec{.target = "/../../etc/passwd"});
+
+BENCHMARK_MAIN();
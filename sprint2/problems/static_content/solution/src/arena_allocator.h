@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+
+namespace http_server {
+
+// Аллокатор, размещающий память в заданном std::pmr::memory_resource.
+// В отличие от std::pmr::polymorphic_allocator, его можно присваивать, чего требуют
+// http::basic_fields и другие контейнеры Beast
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() noexcept
+        : resource_(std::pmr::get_default_resource()) {
+    }
+
+    explicit ArenaAllocator(std::pmr::memory_resource* resource) noexcept
+        : resource_(resource) {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+        : resource_(other.GetResource()) {
+    }
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        resource_->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    std::pmr::memory_resource* GetResource() const noexcept {
+        return resource_;
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return resource_ == other.GetResource();
+    }
+
+private:
+    std::pmr::memory_resource* resource_;
+};
+
+}  // namespace http_server
@@ -0,0 +1,111 @@
+#include "binary_encoding.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "header_values.h"
+
+namespace binary_encoding {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr std::string_view MAP_MAGIC = "GMAP"sv;
+
+class Writer {
+public:
+    explicit Writer(std::string& out)
+        : out_(out) {
+    }
+
+    void Byte(unsigned char value) {
+        out_ += static_cast<char>(value);
+    }
+
+    void Varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            Byte(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        Byte(static_cast<unsigned char>(value));
+    }
+
+    void Int32(std::int32_t value) {
+        const auto bits = static_cast<std::uint32_t>(value);
+        for (int shift = 0; shift < 32; shift += 8) {
+            Byte(static_cast<unsigned char>(bits >> shift));
+        }
+    }
+
+    void String(std::string_view value) {
+        Varint(value.size());
+        out_ += value;
+    }
+
+    void Raw(std::string_view value) {
+        out_ += value;
+    }
+
+private:
+    std::string& out_;
+};
+
+}  // namespace
+
+std::string EncodeMap(const model::Map& map) {
+    std::string out;
+    // Заголовок, строки и по 13-20 байт на объект карты
+    out.reserve(64 + (*map.GetId()).size() + map.GetName().size() + map.GetRoads().size() * 13
+                + map.GetBuildings().size() * 16 + map.GetOffices().size() * 24);
+    Writer writer{out};
+    writer.Raw(MAP_MAGIC);
+    writer.Byte(FORMAT_VERSION);
+    writer.String(*map.GetId());
+    writer.String(map.GetName());
+
+    writer.Varint(map.GetRoads().size());
+    for (const auto& road : map.GetRoads()) {
+        const model::Point start = road.GetStart();
+        const model::Point end = road.GetEnd();
+        writer.Byte(road.IsHorizontal() ? 0 : 1);
+        writer.Int32(start.x);
+        writer.Int32(start.y);
+        writer.Int32(road.IsHorizontal() ? end.x : end.y);
+    }
+
+    writer.Varint(map.GetBuildings().size());
+    for (const auto& building : map.GetBuildings()) {
+        const auto& bounds = building.GetBounds();
+        writer.Int32(bounds.position.x);
+        writer.Int32(bounds.position.y);
+        writer.Int32(bounds.size.width);
+        writer.Int32(bounds.size.height);
+    }
+
+    writer.Varint(map.GetOffices().size());
+    for (const auto& office : map.GetOffices()) {
+        writer.String(*office.GetId());
+        writer.Int32(office.GetPosition().x);
+        writer.Int32(office.GetPosition().y);
+        writer.Int32(office.GetOffset().dx);
+        writer.Int32(office.GetOffset().dy);
+    }
+    return out;
+}
+
+bool PrefersBinary(std::string_view accept) {
+    double binary_quality = 0.0;
+    double json_quality = 0.0;
+    util::ForEachWeightedItem(accept, [&](std::string_view item, double quality) {
+        if (util::EqualsIgnoreCase(item, CONTENT_TYPE)) {
+            binary_quality = std::max(binary_quality, quality);
+        } else if (util::EqualsIgnoreCase(item, "application/json"sv) || item == "application/*"sv
+                   || item == "*/*"sv) {
+            json_quality = std::max(json_quality, quality);
+        }
+    });
+    return binary_quality > 0.0 && binary_quality >= json_quality;
+}
+
+}  // namespace binary_encoding
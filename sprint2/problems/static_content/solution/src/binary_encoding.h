@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+#include "model.h"
+
+// Компактное двоичное представление ответов API, альтернативное JSON.
+// Клиент запрашивает его заголовком Accept: application/x-game-binary.
+//
+// Все числа записываются в порядке little-endian:
+//   varint  - беззнаковое целое по 7 бит в байте, старший бит означает продолжение;
+//   string  - varint с длиной в байтах и затем байты UTF-8;
+//   i32     - знаковое 32-битное целое.
+//
+// Карта (GET /api/v1/maps/{id}):
+//   "GMAP", u8 версия формата (1), string id, string name,
+//   varint число дорог, для каждой: u8 направление (0 - горизонтальная, 1 - вертикальная),
+//       i32 x0, i32 y0, i32 x1 или y1 в зависимости от направления;
+//   varint число зданий, для каждого: i32 x, i32 y, i32 w, i32 h;
+//   varint число офисов, для каждого: string id, i32 x, i32 y, i32 offsetX, i32 offsetY.
+//
+// Декодер для браузера лежит в static/js/binary_decoder.js
+namespace binary_encoding {
+
+inline constexpr std::string_view CONTENT_TYPE = "application/x-game-binary";
+inline constexpr unsigned char FORMAT_VERSION = 1;
+
+std::string EncodeMap(const model::Map& map);
+
+// Проверяет, предпочитает ли клиент двоичное представление JSON по заголовку Accept.
+// Двоичный формат выбирается, только если он назван явно и его q не ниже, чем у JSON
+bool PrefersBinary(std::string_view accept);
+
+}  // namespace binary_encoding
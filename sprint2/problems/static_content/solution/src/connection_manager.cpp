@@ -0,0 +1,205 @@
+#include "connection_manager.h"
+
+#include <algorithm>
+
+namespace http_server {
+
+namespace {
+
+void AppendMetric(std::string& out, std::string_view name, std::string_view type, std::string_view help,
+                  std::uint64_t value) {
+    out.append("# HELP "sv).append(name).append(" "sv).append(help).append("\n"sv);
+    out.append("# TYPE "sv).append(name).append(" "sv).append(type).append("\n"sv);
+    out.append(name).append(" "sv).append(std::to_string(value)).append("\n"sv);
+}
+
+}  // namespace
+
+void AppendMetrics(std::string& out, const ConnectionStats& stats) {
+    AppendMetric(out, "http_sessions_active"sv, "gauge"sv, "Open sessions."sv, stats.active_sessions);
+    AppendMetric(out, "http_session_buffered_bytes"sv, "gauge"sv, "Memory held by sessions."sv,
+                 stats.buffered_bytes);
+    AppendMetric(out, "http_connections_accepted_total"sv, "counter"sv, "Connections admitted."sv, stats.accepted);
+    AppendMetric(out, "http_connections_rejected_total"sv, "counter"sv,
+                 "Connections closed over the per-address limit."sv, stats.rejected_per_address);
+    AppendMetric(out, "http_accept_pauses_total"sv, "counter"sv, "Times accept was paused."sv, stats.accept_pauses);
+    AppendMetric(out, "http_accept_errors_total"sv, "counter"sv, "Failed accept operations."sv, stats.accept_errors);
+    AppendMetric(out, "http_requests_shed_total"sv, "counter"sv, "Requests answered with 503 under overload."sv,
+                 stats.shed_requests);
+    AppendMetric(out, "http_event_loop_lag_microseconds"sv, "gauge"sv, "Largest recent event loop lag."sv,
+                 static_cast<std::uint64_t>(stats.loop_lag.count()));
+}
+
+ConnectionManager::ConnectionManager(ConnectionLimits limits)
+    : limits_(limits)
+    , sessions_per_address_(std::make_unique<std::atomic<std::uint32_t>[]>(ADDRESS_BUCKETS)) {
+}
+
+std::size_t ConnectionManager::GetAddressBucket(const net::ip::address& address) noexcept {
+    std::uint64_t hash = 0;
+    if (address.is_v4()) {
+        hash = address.to_v4().to_uint();
+    } else {
+        for (const unsigned char byte : address.to_v6().to_bytes()) {
+            hash = hash * 31 + byte;
+        }
+    }
+    // Перемешиваем биты, чтобы соседние адреса не попадали в соседние корзины
+    hash *= 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>(hash >> 48) % ADDRESS_BUCKETS;
+}
+
+bool ConnectionManager::TryAdmit(const net::ip::address& address) {
+    if (IsDraining()) {
+        return false;
+    }
+    auto& count = sessions_per_address_[GetAddressBucket(address)];
+    if (count.fetch_add(1, std::memory_order_relaxed) >= limits_.max_sessions_per_address) {
+        count.fetch_sub(1, std::memory_order_relaxed);
+        rejected_per_address_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    sessions_.fetch_add(1, std::memory_order_relaxed);
+    accepted_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ConnectionManager::Release(const net::ip::address& address) noexcept {
+    sessions_per_address_[GetAddressBucket(address)].fetch_sub(1, std::memory_order_relaxed);
+    sessions_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool ConnectionManager::IsOverloaded(const ContextShard& shard) const noexcept {
+    if (buffered_bytes_.load(std::memory_order_relaxed) >= limits_.max_buffered_bytes) {
+        return true;
+    }
+    // Задержка другого io_context не мешает этому обслуживать свои соединения
+    const auto max_lag_us = std::chrono::duration_cast<std::chrono::microseconds>(limits_.max_loop_lag).count();
+    return shard.lag_us_.load(std::memory_order_relaxed) > max_lag_us;
+}
+
+ContextShard& ConnectionManager::GetShard(net::io_context& ioc) {
+    std::lock_guard lock{shards_mutex_};
+    for (ContextShard& shard : shards_) {
+        if (&shard.ioc_ == &ioc) {
+            return shard;
+        }
+    }
+    ContextShard& shard = shards_.emplace_back(ioc);
+    ScheduleProbe(shard);
+    return shard;
+}
+
+void ConnectionManager::ScheduleProbe(ContextShard& shard) {
+    shard.probe_timer_->expires_after(LAG_PROBE_INTERVAL);
+    shard.probe_timer_->async_wait([this, &shard](boost::system::error_code ec) {
+        if (ec) {
+            return;
+        }
+        // Насколько позже назначенного времени цикл событий добрался до таймера
+        const auto lag = std::chrono::steady_clock::now() - shard.probe_timer_->expiry();
+        shard.lag_us_.store(std::chrono::duration_cast<std::chrono::microseconds>(lag).count(),
+                            std::memory_order_relaxed);
+        ScheduleProbe(shard);
+    });
+}
+
+void ConnectionManager::Register(ContextShard& shard, Drainable& target) {
+    {
+        std::lock_guard lock{shard.mutex_};
+        // Drain сначала выставляет draining_, а затем обходит шарды под их мьютексами,
+        // поэтому объект либо попадёт в обход, либо увидит начавшуюся остановку
+        if (!IsDraining()) {
+            target.shard_ = &shard;
+            target.prev_drainable_ = nullptr;
+            target.next_drainable_ = shard.targets_;
+            if (shard.targets_) {
+                shard.targets_->prev_drainable_ = &target;
+            }
+            shard.targets_ = &target;
+            return;
+        }
+    }
+    target.Drain();
+}
+
+void ConnectionManager::Unregister(Drainable& target) noexcept {
+    // shard_ меняет только сам объект, поэтому его можно прочитать без блокировки
+    ContextShard* shard = target.shard_;
+    if (!shard) {
+        return;
+    }
+    std::lock_guard lock{shard->mutex_};
+    if (target.prev_drainable_) {
+        target.prev_drainable_->next_drainable_ = target.next_drainable_;
+    } else {
+        shard->targets_ = target.next_drainable_;
+    }
+    if (target.next_drainable_) {
+        target.next_drainable_->prev_drainable_ = target.prev_drainable_;
+    }
+    target.prev_drainable_ = target.next_drainable_ = nullptr;
+    target.shard_ = nullptr;
+}
+
+void ConnectionManager::Drain(net::io_context& ioc, std::chrono::milliseconds timeout,
+                              std::function<void()> on_drained) {
+    if (draining_.exchange(true)) {
+        return;
+    }
+    {
+        // Drain лишь ставит работу в очередь, поэтому его можно вызывать под мьютексом.
+        // Мьютекс шарда не даёт объекту разрушиться, пока он уведомляется
+        std::lock_guard shards_lock{shards_mutex_};
+        for (ContextShard& shard : shards_) {
+            std::lock_guard lock{shard.mutex_};
+            for (Drainable* target = shard.targets_; target; target = target->next_drainable_) {
+                target->Drain();
+            }
+        }
+    }
+    on_drained_ = std::move(on_drained);
+    drain_timer_.emplace(ioc);
+    WaitDrained(std::chrono::steady_clock::now() + timeout);
+}
+
+void ConnectionManager::WaitDrained(std::chrono::steady_clock::time_point deadline) {
+    if (sessions_.load(std::memory_order_relaxed) == 0 || std::chrono::steady_clock::now() >= deadline) {
+        return on_drained_();
+    }
+    drain_timer_->expires_after(DRAIN_POLL_INTERVAL);
+    drain_timer_->async_wait([this, deadline](boost::system::error_code ec) {
+        if (!ec) {
+            WaitDrained(deadline);
+        }
+    });
+}
+
+void ConnectionManager::Shutdown() noexcept {
+    // Ожидающие обработчики таймеров получают operation_aborted, но io_context остановлены,
+    // и обработчики будут лишь разрушены вместе с ними
+    drain_timer_.reset();
+    std::lock_guard lock{shards_mutex_};
+    for (ContextShard& shard : shards_) {
+        shard.probe_timer_.reset();
+    }
+}
+
+ConnectionStats ConnectionManager::GetStats() const {
+    ConnectionStats stats;
+    stats.active_sessions = sessions_.load(std::memory_order_relaxed);
+    stats.buffered_bytes = buffered_bytes_.load(std::memory_order_relaxed);
+    stats.accepted = accepted_.load(std::memory_order_relaxed);
+    stats.rejected_per_address = rejected_per_address_.load(std::memory_order_relaxed);
+    stats.accept_pauses = accept_pauses_.load(std::memory_order_relaxed);
+    stats.accept_errors = accept_errors_.load(std::memory_order_relaxed);
+    stats.shed_requests = shed_requests_.load(std::memory_order_relaxed);
+    std::lock_guard lock{shards_mutex_};
+    for (const ContextShard& shard : shards_) {
+        stats.loop_lag = std::max(stats.loop_lag,
+                                  std::chrono::microseconds{shard.lag_us_.load(std::memory_order_relaxed)});
+    }
+    return stats;
+}
+
+}  // namespace http_server
@@ -0,0 +1,214 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http_server {
+
+namespace net = boost::asio;
+using namespace std::literals;
+
+// Ограничения, защищающие сервер от перегрузки
+struct ConnectionLimits {
+    // Сколько сессий может быть открыто одновременно
+    std::size_t max_sessions = 10'000;
+    // Сколько сессий может быть открыто с одного IP-адреса
+    std::size_t max_sessions_per_address = 256;
+    // Сколько памяти могут занимать все сессии вместе (объекты сессий и буферы чтения)
+    std::size_t max_buffered_bytes = 512 * 1024 * 1024;
+    // Допустимая задержка цикла событий. При её превышении новые запросы получают 503
+    std::chrono::milliseconds max_loop_lag = 200ms;
+};
+
+// Снимок счётчиков ConnectionManager
+struct ConnectionStats {
+    std::size_t active_sessions = 0;
+    std::size_t buffered_bytes = 0;
+    std::uint64_t accepted = 0;
+    std::uint64_t rejected_per_address = 0;
+    std::uint64_t accept_pauses = 0;
+    std::uint64_t accept_errors = 0;
+    std::uint64_t shed_requests = 0;
+    // Наибольшая из последних измеренных задержек циклов событий
+    std::chrono::microseconds loop_lag{0};
+};
+
+// Добавляет счётчики в out в текстовом формате Prometheus
+void AppendMetrics(std::string& out, const ConnectionStats& stats);
+
+class ContextShard;
+
+// Участник плавной остановки сервера: акцептор или сессия.
+// Drain может быть вызван из любого потока и должен лишь поставить работу в очередь
+// executor-а объекта
+class Drainable {
+public:
+    virtual void Drain() = 0;
+
+protected:
+    Drainable() = default;
+    Drainable(const Drainable&) = delete;
+    Drainable& operator=(const Drainable&) = delete;
+    ~Drainable() = default;
+
+private:
+    friend class ConnectionManager;
+
+    // Объекты связаны в список прямо через свои поля, чтобы регистрация сессии
+    // не выделяла память. Список защищён мьютексом ContextShard, в котором объект
+    // зарегистрирован. nullptr, если объект не зарегистрирован
+    ContextShard* shard_ = nullptr;
+    Drainable* prev_drainable_ = nullptr;
+    Drainable* next_drainable_ = nullptr;
+};
+
+// Часть ConnectionManager, относящаяся к одному io_context: акцептор и сессии, которые
+// на нём работают, и задержка его цикла событий. В режиме kPerCore со списком работает
+// только поток этого io_context, поэтому мьютекс списка не разделяется между ядрами
+class ContextShard {
+public:
+    explicit ContextShard(net::io_context& ioc)
+        : ioc_(ioc) {
+        probe_timer_.emplace(ioc);
+    }
+
+    ContextShard(const ContextShard&) = delete;
+    ContextShard& operator=(const ContextShard&) = delete;
+
+private:
+    friend class ConnectionManager;
+
+    net::io_context& ioc_;
+    // Таймер, по запаздыванию которого судим о загруженности io_context.
+    // Разрушается в ConnectionManager::Shutdown, пока io_context ещё существует
+    std::optional<net::steady_timer> probe_timer_;
+    std::atomic<std::int64_t> lag_us_{0};
+    std::mutex mutex_;
+    Drainable* targets_ = nullptr;
+};
+
+// Контроль допуска соединений. Общий для всех Listener и сессий сервера.
+// Listener спрашивает его, можно ли принимать соединения, а сессии сообщают,
+// сколько памяти занимают, и проверяют, не пора ли отвечать 503
+class ConnectionManager {
+public:
+    explicit ConnectionManager(ConnectionLimits limits = {});
+
+    ConnectionManager(const ConnectionManager&) = delete;
+    ConnectionManager& operator=(const ConnectionManager&) = delete;
+
+    const ConnectionLimits& GetLimits() const noexcept {
+        return limits_;
+    }
+
+    // Можно ли принимать новые соединения. Если нет, Listener приостанавливает accept
+    bool CanAccept() const noexcept {
+        return sessions_.load(std::memory_order_relaxed) < limits_.max_sessions
+            && buffered_bytes_.load(std::memory_order_relaxed) < limits_.max_buffered_bytes;
+    }
+
+    // Регистрирует сессию с адреса address. Возвращает false, если с этого адреса
+    // уже открыто слишком много сессий или сервер останавливается - такое соединение
+    // следует сразу закрыть
+    bool TryAdmit(const net::ip::address& address);
+    // Снимает с учёта сессию, ранее допущенную TryAdmit
+    void Release(const net::ip::address& address) noexcept;
+
+    // Учитывает изменение объёма памяти, занимаемой сессией
+    void AddBufferedBytes(std::ptrdiff_t delta) noexcept {
+        buffered_bytes_.fetch_add(static_cast<std::size_t>(delta), std::memory_order_relaxed);
+    }
+
+    // Перегружен ли сервер настолько, что новые запросы на io_context шарда shard нужно
+    // отклонять: исчерпан общий лимит памяти или не успевает цикл событий этого io_context
+    bool IsOverloaded(const ContextShard& shard) const noexcept;
+
+    void OnAcceptPaused() noexcept {
+        accept_pauses_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void OnAcceptError() noexcept {
+        accept_errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void OnRequestShed() noexcept {
+        shed_requests_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Возвращает шард io_context ioc. При первом обращении создаёт его и запускает
+    // периодическое измерение задержки цикла событий ioc. Вызывается при создании акцептора
+    ContextShard& GetShard(net::io_context& ioc);
+
+    ConnectionStats GetStats() const;
+
+    // Регистрирует в шарде акцептор или сессию, которую нужно уведомить о плавной остановке.
+    // Если остановка уже началась, объект уведомляется сразу.
+    // Объект должен вызвать Unregister до своего разрушения
+    void Register(ContextShard& shard, Drainable& target);
+    void Unregister(Drainable& target) noexcept;
+
+    bool IsDraining() const noexcept {
+        return draining_.load(std::memory_order_relaxed);
+    }
+
+    // Начинает плавную остановку: акцепторы перестают принимать соединения, а сессии
+    // дописывают ответы на уже прочитанные запросы и закрываются. Когда сессий не останется
+    // или истечёт timeout, на ioc будет вызван on_drained
+    void Drain(net::io_context& ioc, std::chrono::milliseconds timeout, std::function<void()> on_drained);
+
+    // Разрушает таймеры, работающие на io_context сервера. Вызывается, когда io_context уже
+    // не выполняются, но ещё не разрушены. Последнюю ссылку на ConnectionManager может
+    // освободить разрушение одного из io_context, и таймер другого, уже разрушенного,
+    // обратился бы к освобождённой памяти
+    void Shutdown() noexcept;
+
+private:
+    static constexpr auto LAG_PROBE_INTERVAL = 50ms;
+    // Как часто при плавной остановке проверяется, остались ли сессии
+    static constexpr auto DRAIN_POLL_INTERVAL = 20ms;
+
+    // Число корзин счётчиков сессий по адресам
+    static constexpr std::size_t ADDRESS_BUCKETS = 65'536;
+
+    static std::size_t GetAddressBucket(const net::ip::address& address) noexcept;
+
+    void ScheduleProbe(ContextShard& shard);
+    void WaitDrained(std::chrono::steady_clock::time_point deadline);
+
+    ConnectionLimits limits_;
+    std::atomic<std::size_t> sessions_{0};
+    std::atomic<std::size_t> buffered_bytes_{0};
+    std::atomic<std::uint64_t> accepted_{0};
+    std::atomic<std::uint64_t> rejected_per_address_{0};
+    std::atomic<std::uint64_t> accept_pauses_{0};
+    std::atomic<std::uint64_t> accept_errors_{0};
+    std::atomic<std::uint64_t> shed_requests_{0};
+
+    // Счётчики сессий по адресам. Адрес попадает в корзину по хешу, и адреса одной корзины
+    // делят общий лимит: при коллизии лимит срабатывает раньше, но никогда не позже.
+    // Зато допуск соединения обходится без мьютекса и выделения памяти
+    std::unique_ptr<std::atomic<std::uint32_t>[]> sessions_per_address_;
+
+    // Шарды только добавляются, deque сохраняет их адреса. Мьютекс защищает сам deque
+    // и нужен лишь при создании акцепторов, плавной остановке и сборе статистики
+    mutable std::mutex shards_mutex_;
+    std::deque<ContextShard> shards_;
+
+    std::atomic<bool> draining_{false};
+    std::optional<net::steady_timer> drain_timer_;
+    std::function<void()> on_drained_;
+};
+
+}  // namespace http_server
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+// Возвращает строгий ETag (RFC 9110), вычисленный как 64-битный хеш FNV-1a содержимого
+inline std::string MakeETag(std::string_view content) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : content) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+
+    constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    std::string etag(18, '"');
+    for (int i = 16; i > 0; --i, hash >>= 4) {
+        etag[i] = HEX_DIGITS[hash & 0xf];
+    }
+    return etag;
+}
+
+// Проверяет, есть ли etag в списке из заголовка If-None-Match.
+// Для If-None-Match используется слабое сравнение, поэтому префикс W/ игнорируется
+inline bool MatchesETag(std::string_view etag_list, std::string_view etag) {
+    using namespace std::literals;
+    while (!etag_list.empty()) {
+        const auto comma = etag_list.find(',');
+        std::string_view candidate = etag_list.substr(0, comma);
+        const auto begin = candidate.find_first_not_of(" \t"sv);
+        candidate = begin == std::string_view::npos
+                        ? std::string_view{}
+                        : candidate.substr(begin, candidate.find_last_not_of(" \t"sv) - begin + 1);
+        if (candidate.starts_with("W/"sv)) {
+            candidate.remove_prefix(2);
+        }
+        if (candidate == "*"sv || candidate == etag) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        etag_list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+}  // namespace util
@@ -0,0 +1,53 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+// Убирает пробельные символы whitespace по краям value
+inline std::string_view Trim(std::string_view value, std::string_view whitespace = " \t") {
+    const auto begin = value.find_first_not_of(whitespace);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return value.substr(begin, value.find_last_not_of(whitespace) - begin + 1);
+}
+
+inline bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char l, char r) {
+               return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+           });
+}
+
+// Перебирает элементы списка из заголовков Accept и Accept-Encoding (RFC 9110, раздел 12.4.2)
+// и вызывает visitor(value, quality) для каждого. Параметр q может стоять после других
+// параметров элемента, например "application/x-game-binary;v=1;q=0". Без q качество равно 1
+template <typename Visitor>
+void ForEachWeightedItem(std::string_view list, Visitor&& visitor) {
+    using namespace std::literals;
+    while (!list.empty()) {
+        const auto comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+
+        double quality = 1.0;
+        if (const auto semicolon = item.find(';'); semicolon != std::string_view::npos) {
+            std::string_view params = item.substr(semicolon + 1);
+            while (!params.empty()) {
+                const auto next = params.find(';');
+                const std::string_view param = Trim(params.substr(0, next));
+                params.remove_prefix(next == std::string_view::npos ? params.size() : next + 1);
+                if (param.starts_with("q="sv) || param.starts_with("Q="sv)) {
+                    quality = std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+                }
+            }
+            item = item.substr(0, semicolon);
+        }
+        visitor(Trim(item), quality);
+    }
+}
+
+}  // namespace util
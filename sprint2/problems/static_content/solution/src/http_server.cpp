@@ -2,12 +2,124 @@
 
 #include <boost/asio/dispatch.hpp>
 #include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace http_server {
-    void SessionBase::Run() {
-    // Вызываем метод Read, используя executor объекта stream_.
-    // Таким образом вся работа со stream_ будет выполняться, используя его executor
-    net::dispatch(stream_.get_executor(),
-                  beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
+
+namespace {
+
+// Привязывает текущий поток к ядру cpu. На других платформах ничего не делает
+void PinCurrentThread(unsigned cpu) {
+#ifdef __linux__
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset); err != 0) {
+        ReportError(beast::error_code(err, beast::system_category()), "pin thread"sv);
+    }
+#else
+    (void)cpu;
+#endif
+}
+
+}  // namespace
+
+void SessionBase::Start(const net::ip::address& remote_address) {
+    remote_address_ = remote_address;
+    accepted_at_ = Clock::now();
+    buffered_bytes_ = sizeof(SessionBase) + buffer_.capacity();
+    connections_->AddBufferedBytes(static_cast<std::ptrdiff_t>(buffered_bytes_));
+    started_ = true;
+    connections_->Register(context_shard_, *this);
+    // Вызываем метод Read, используя executor объекта socket_.
+    // Таким образом вся работа со socket_ будет выполняться, используя его executor
+    net::dispatch(socket_.get_executor(),
+                  BindRecyclingAllocator(beast::bind_front_handler(&SessionBase::Read, GetSharedThis())));
+}
+
+void SessionBase::Finish() noexcept {
+    if (!started_) {
+        return;
     }
+    started_ = false;
+    connections_->Unregister(*this);
+    connections_->AddBufferedBytes(-static_cast<std::ptrdiff_t>(buffered_bytes_));
+    connections_->Release(remote_address_);
+}
+
+void SessionBase::Reset() noexcept {
+    beast::error_code ec;
+    socket_.close(ec);
+    timer_.cancel();
+    // Ответы и запрос размещены в арене, поэтому освобождаются раньше неё
+    write_queue_.clear();
+    request_ = MakeRequest();
+    pool_.release();
+    arena_.release();
+    buffer_.clear();
+    if (buffer_.capacity() > MAX_RECYCLED_BUFFER_SIZE) {
+        buffer_.shrink_to_fit();
+    }
+    bytes_read_ = 0;
+    buffered_bytes_ = 0;
+    first_byte_sent_ = false;
+    reading_ = false;
+    read_closed_ = false;
+    draining_ = false;
+}
+
+void SessionBase::Drain() {
+    // Drain вызывается из другого потока и может застать сессию, на которую уже
+    // не осталось ссылок: такую сессию останавливать не нужно
+    if (auto self = GetWeakThis().lock()) {
+        net::post(socket_.get_executor(),
+                  BindRecyclingAllocator(beast::bind_front_handler(&SessionBase::OnDrain, std::move(self))));
+    }
+}
+
+IoContextPool::IoContextPool(Mode mode, unsigned num_threads, bool pin_threads)
+    : mode_(mode)
+    , num_threads_(std::max(1u, num_threads))
+    , pin_threads_(pin_threads) {
+    if (mode_ == Mode::kShared) {
+        contexts_.push_back(std::make_unique<net::io_context>(num_threads_));
+    } else {
+        // Каждый io_context обслуживается единственным потоком, поэтому подсказка
+        // concurrency_hint = 1 позволяет Asio не захватывать мьютексы планировщика
+        contexts_.reserve(num_threads_);
+        for (unsigned i = 0; i < num_threads_; ++i) {
+            contexts_.push_back(std::make_unique<net::io_context>(1));
+        }
+    }
+}
+
+void IoContextPool::Run() {
+    const unsigned num_cpus = std::max(1u, std::thread::hardware_concurrency());
+    auto run_context = [this, num_cpus](unsigned thread_index) {
+        if (pin_threads_) {
+            PinCurrentThread(thread_index % num_cpus);
+        }
+        const size_t context_index = mode_ == Mode::kShared ? 0 : thread_index;
+        contexts_[context_index]->run();
+    };
+
+    std::vector<std::jthread> workers;
+    workers.reserve(num_threads_ - 1);
+    for (unsigned i = 1; i < num_threads_; ++i) {
+        workers.emplace_back(run_context, i);
+    }
+    run_context(0);
+}
+
+void IoContextPool::Stop() {
+    for (auto& ioc : contexts_) {
+        ioc->stop();
+    }
+}
+
 }  // namespace http_server
@@ -1,13 +1,31 @@
 #pragma once
 #include "sdk.h"
-// boost.beast будет использовать std::string_view вместо boost::string_view
-#define BOOST_BEAST_USE_STD_STRING_VIEW
+#include "arena_allocator.h"
+#include "connection_manager.h"
+#include "logger.h"
+#include "metrics.h"
+#include "recycling_allocator.h"
+#include "request_context.h"
+#include "tracing.h"
 
+#include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/circular_buffer.hpp>
+#include <array>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 namespace http_server {
 
@@ -17,85 +35,527 @@ namespace beast = boost::beast;
 namespace http = beast::http;
 using namespace std::literals;
 
+// what должна ссылаться на строку со статическим временем жизни, например литерал
 inline void ReportError(beast::error_code ec, std::string_view what) {
+    if (auto* logger = logging::GetLogger()) {
+        logging::LogRecord record;
+        record.kind = logging::LogRecord::Kind::kError;
+        record.timestamp = std::chrono::system_clock::now();
+        record.label = what;
+        record.text.Assign(ec.message());
+        return logger->Log(record);
+    }
     std::cerr << what << ": "sv << ec.message() << std::endl;
 }
 
+#ifdef SO_REUSEPORT
+// Опция SO_REUSEPORT позволяет нескольким акцепторам слушать один и тот же порт.
+// Ядро само распределяет входящие соединения между ними
+using ReusePort = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+// Набор io_context, на которых работает сервер.
+// В режиме kShared все рабочие потоки обслуживают один общий io_context.
+// В режиме kPerCore каждый поток владеет собственным io_context и принимает соединения
+// на своём SO_REUSEPORT-акцепторе, поэтому сессия не покидает поток, который её принял
+class IoContextPool {
+public:
+    enum class Mode { kShared, kPerCore };
+
+    IoContextPool(Mode mode, unsigned num_threads, bool pin_threads = false);
+
+    IoContextPool(const IoContextPool&) = delete;
+    IoContextPool& operator=(const IoContextPool&) = delete;
+
+    Mode GetMode() const noexcept {
+        return mode_;
+    }
+
+    size_t Size() const noexcept {
+        return contexts_.size();
+    }
+
+    net::io_context& GetContext(size_t index) {
+        return *contexts_.at(index);
+    }
+
+    // Выполняет io_context на всех рабочих потоках, включая текущий, и ждёт их завершения
+    void Run();
+    // Останавливает все io_context. Можно вызывать из любого потока
+    void Stop();
+
+private:
+    Mode mode_;
+    unsigned num_threads_;
+    bool pin_threads_;
+    std::vector<std::unique_ptr<net::io_context>> contexts_;
+};
+
 
-class SessionBase {
+// Strand конкретного типа вместо any_io_executor: копирование и отслеживание работы
+// такого executor-а не выделяют память
+using StrandExecutor = net::strand<net::io_context::executor_type>;
+using StrandTimer = net::basic_waitable_timer<std::chrono::steady_clock, net::wait_traits<std::chrono::steady_clock>,
+                                              StrandExecutor>;
+
+// Сессия обслуживает одно соединение за другим: когда соединение закрыто, Listener
+// возвращает объект сессии в пул, сохраняя его strand, буфер чтения и арену
+class SessionBase : public Drainable {
 public:
+    using Executor = StrandExecutor;
+    using Socket = net::basic_stream_socket<tcp, Executor>;
+
     // Запрещаем копирование и присваивание объектов SessionBase и его наследников
     SessionBase(const SessionBase&) = delete;
     SessionBase& operator=(const SessionBase&) = delete;
-    void Run();
+
+    // Сокет, в который Listener принимает соединение
+    Socket& GetSocket() {
+        return socket_;
+    }
+
+    // Начинает обслуживание принятого соединения.
+    // Соединение должно быть предварительно допущено вызовом connections->TryAdmit(remote_address)
+    void Start(const net::ip::address& remote_address);
+    // Снимает соединение с учёта в connections_. Вызывается, когда на сессию не осталось ссылок
+    void Finish() noexcept;
+    // Закрывает соединение и готовит сессию к обслуживанию следующего
+    void Reset() noexcept;
+
+    void Drain() override;
     template<typename Body, typename Fields>
     void Write(http::response<Body, Fields>&& response) {
-        // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
-        auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
-        auto self = GetSharedThis();
-        http::async_write(stream_, *safe_response,
-                          [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-                              self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                          });
+        if (draining_) {
+            // Сервер останавливается, и этот ответ последний в соединении
+            response.keep_alive(false);
+        }
+        // Ответы отправляются строго в порядке поступления запросов.
+        // Пока пишется предыдущий ответ, новый ждёт своей очереди.
+        // Место под ответ берётся из пула сессии, поэтому в установившемся режиме
+        // ответы не выделяют память в куче
+        using Response = QueuedResponse<Body, Fields>;
+        std::pmr::polymorphic_allocator<> allocator{&pool_};
+        auto* queued = allocator.new_object<Response>(std::move(response));
+        queued->storage = queued;
+        queued->size = sizeof(Response);
+        queued->alignment = alignof(Response);
+        queued->resource = &pool_;
+        queued->route = GetRequestRoute();
+        queued->status = queued->response.result_int();
+        queued->bytes_read = bytes_read_;
+        queued->read_at = read_at_;
+        queued->method = request_method_;
+        queued->target = request_target_;
+        if (write_queue_.full()) {
+            // Обработчик ответил на запрос несколько раз
+            write_queue_.set_capacity(write_queue_.capacity() * 2);
+        }
+        write_queue_.push_back(QueuedWritePtr{queued});
+        // Ожидание в очереди, пока пишутся ответы на предыдущие запросы конвейера
+        TRACE_ASYNC_BEGIN("queue", queued);
+        if (write_queue_.size() == 1) {
+            WriteFront();
+        }
     }
 protected:
-    using HttpRequest = http::request<http::string_body>;
-    explicit SessionBase(tcp::socket&& socket)
-        : stream_(std::move(socket)) {
+    // Запрос целиком (поля заголовка, target и тело) размещается в арене сессии
+    using RequestAllocator = ArenaAllocator<char>;
+    using HttpRequest = http::request<http::basic_string_body<char, std::char_traits<char>, RequestAllocator>,
+                                      http::basic_fields<RequestAllocator>>;
+
+    SessionBase(const Executor& executor, std::shared_ptr<ConnectionManager> connections, ContextShard& shard,
+                std::shared_ptr<Metrics> metrics)
+        : socket_(executor)
+        , connections_(std::move(connections))
+        , context_shard_(shard)
+        , metrics_(std::move(metrics)) {
     }
 
-    ~SessionBase() = default;
+    ~SessionBase() {
+        Finish();
+    }
 private:
-    // tcp_stream содержит внутри себя сокет и добавляет поддержку таймаутов
-    beast::tcp_stream stream_;
+    // Сколько ответов может ожидать отправки. Пока очередь заполнена,
+    // следующие запросы конвейера (HTTP pipelining) не читаются
+    static constexpr size_t MAX_QUEUED_RESPONSES = 8;
+    // Буфер чтения большей ёмкости не сохраняется при возврате сессии в пул
+    static constexpr size_t MAX_RECYCLED_BUFFER_SIZE = 64 * 1024;
+    // Если за это время соединение не продвинулось ни в чтении запроса, ни в записи ответа,
+    // оно закрывается
+    static constexpr auto REQUEST_TIMEOUT = 30s;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Ответ в очереди на отправку. Скрывает конкретный тип http::response
+    struct QueuedWrite {
+        virtual ~QueuedWrite() = default;
+        virtual void Write(SessionBase& session) = 0;
+
+        // Где размещён объект: его освобождает QueuedWriteDeleter
+        void* storage = nullptr;
+        std::size_t size = 0;
+        std::size_t alignment = 0;
+        std::pmr::memory_resource* resource = nullptr;
+
+        // Сведения для метрик о запросе, на который дан ответ
+        RouteId route = UNKNOWN_ROUTE;
+        unsigned status = 0;
+        std::size_t bytes_read = 0;
+        Clock::time_point read_at;
+        Clock::time_point write_started_at;
+        // Для журнала запросов
+        std::string_view method;
+        logging::FixedString<logging::LogRecord::TEXT_CAPACITY> target;
+    };
+
+    template <typename Body, typename Fields>
+    struct QueuedResponse : QueuedWrite {
+        explicit QueuedResponse(http::response<Body, Fields>&& r)
+            : response(std::move(r)) {
+        }
+
+        void Write(SessionBase& session) override {
+            http::async_write(session.socket_, response,
+                              BindRecyclingAllocator(beast::bind_front_handler(
+                                  &SessionBase::OnWrite, session.GetSharedThis(), response.need_eof())));
+        }
+
+        http::response<Body, Fields> response;
+    };
+
+#ifdef __linux__
+    // Ответы с файлом отправляются через sendfile: заголовок пишет Beast, а содержимое
+    // файла ядро копирует из page cache прямо в сокет, минуя память процесса
+    template <typename Fields>
+    struct QueuedResponse<http::file_body, Fields> : QueuedWrite {
+        explicit QueuedResponse(http::response<http::file_body, Fields>&& r)
+            : response(std::move(r))
+            , serializer(response) {
+        }
+
+        void Write(SessionBase& session) override {
+            http::async_write_header(
+                session.socket_, serializer,
+                BindRecyclingAllocator(
+                    [this, self = session.GetSharedThis()](beast::error_code ec, std::size_t bytes) mutable {
+                        if (ec) {
+                            return self->OnWrite(true, ec, bytes);
+                        }
+                        bytes_written = bytes;
+                        SendFile(std::move(self));
+                    }));
+        }
+
+        // self передаётся от операции к операции без копирования
+        void SendFile(std::shared_ptr<SessionBase> self) {
+            SessionBase& session = *self;
+            auto& socket = session.socket_;
+            beast::error_code ec;
+            socket.native_non_blocking(true, ec);
+            const int file_fd = response.body().file().native_handle();
+            const auto size = static_cast<off_t>(response.body().size());
+            while (!ec && offset < size) {
+                const ssize_t sent = ::sendfile(socket.native_handle(), file_fd, &offset, size - offset);
+                if (sent > 0) {
+                    bytes_written += sent;
+                } else if (sent < 0 && errno == EINTR) {
+                    continue;
+                } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    // Буфер сокета заполнен - ждём, когда в него снова можно будет писать
+                    return socket.async_wait(
+                        tcp::socket::wait_write,
+                        BindRecyclingAllocator([this, self = std::move(self)](beast::error_code ec) mutable {
+                            if (ec) {
+                                return self->OnWrite(true, ec, bytes_written);
+                            }
+                            // Клиент принял часть файла - отсчёт таймаута начинается заново
+                            self->ArmTimer();
+                            SendFile(std::move(self));
+                        }));
+                } else if (sent == 0) {
+                    // Файл стал короче, чем был при открытии
+                    ec = http::error::partial_message;
+                } else {
+                    ec = beast::error_code(errno, beast::system_category());
+                }
+            }
+            // После вызова OnWrite этот объект удалён из очереди, обращаться к полям нельзя
+            session.OnWrite(ec ? true : response.need_eof(), ec, bytes_written);
+        }
+
+        http::response<http::file_body, Fields> response;
+        http::response_serializer<http::file_body, Fields> serializer;
+        off_t offset = 0;
+        std::size_t bytes_written = 0;
+    };
+#endif
+
+    struct QueuedWriteDeleter {
+        void operator()(QueuedWrite* write) const noexcept {
+            void* storage = write->storage;
+            const std::size_t size = write->size;
+            const std::size_t alignment = write->alignment;
+            std::pmr::memory_resource* resource = write->resource;
+            std::destroy_at(write);
+            resource->deallocate(storage, size, alignment);
+        }
+    };
+    using QueuedWritePtr = std::unique_ptr<QueuedWrite, QueuedWriteDeleter>;
+
+    // Начальный размер арены, размещаемой прямо в объекте сессии.
+    // Его хватает для заголовков типичного запроса и ответа
+    static constexpr size_t ARENA_INLINE_SIZE = 4096;
+
+    // Арена для запросов и заголовков ответов. Пул переиспользует освобождённые блоки, пока
+    // через сессию идут запросы конвейера, а когда ответов в очереди не остаётся, арена целиком
+    // перематывается к началу. Поля объявлены раньше всех, кто размещает в них память
+    std::array<std::byte, ARENA_INLINE_SIZE> arena_buffer_;
+    std::pmr::monotonic_buffer_resource arena_{arena_buffer_.data(), arena_buffer_.size()};
+    std::pmr::unsynchronized_pool_resource pool_{&arena_};
+
+    Socket socket_;
+    // Таймаут ожидания запроса. Таймеры beast::basic_stream работают через any_io_executor
+    // и выделяют память на каждую операцию, поэтому сессия следит за таймаутом сама
+    StrandTimer timer_{socket_.get_executor()};
     beast::flat_buffer buffer_;
-    HttpRequest request_;
+    HttpRequest request_{MakeRequest()};
+    boost::circular_buffer<QueuedWritePtr> write_queue_{MAX_QUEUED_RESPONSES};
+    std::shared_ptr<ConnectionManager> connections_;
+    // Шард io_context, на котором работает сессия
+    ContextShard& context_shard_;
+    std::shared_ptr<Metrics> metrics_;
+    net::ip::address remote_address_;
+    // Соединение допущено и учтено в connections_
+    bool started_ = false;
+    // Моменты принятия соединения и получения последнего запроса, размер этого запроса
+    Clock::time_point accepted_at_;
+    Clock::time_point read_at_;
+    std::size_t bytes_read_ = 0;
+    // Метод и target последнего запроса для журнала. Сам запрос передаётся обработчику
+    std::string_view request_method_;
+    logging::FixedString<logging::LogRecord::TEXT_CAPACITY> request_target_;
+    // В соединении уже начата отправка ответа
+    bool first_byte_sent_ = false;
+    // Сколько памяти сессия учла в connections_: сам объект и буфер чтения
+    std::size_t buffered_bytes_ = 0;
+    // Выполняется операция чтения
+    bool reading_ = false;
+    // Новых запросов не будет: клиент закрыл соединение или попросил закрыть его
+    bool read_closed_ = false;
+    // Сервер плавно останавливается
+    bool draining_ = false;
+
     void Read() {
         using namespace std::literals;
+        reading_ = true;
         // Очищаем запрос от прежнего значения (метод Read может быть вызван несколько раз)
-        request_ = {};
-        stream_.expires_after(30s);
-        // Считываем request_ из stream_, используя buffer_ для хранения считанных данных
-        http::async_read(stream_, buffer_, request_,
+        request_ = MakeRequest();
+        if (write_queue_.empty()) {
+            // Ни запрос, ни ответы больше не ссылаются на память арены
+            pool_.release();
+            arena_.release();
+            // Пока пишутся ответы, действует таймаут записи: чтение следующего запроса
+            // конвейера не должно продлевать его медленно читающему клиенту
+            ArmTimer();
+        }
+        TRACE_ASYNC_BEGIN("read", this);
+        // Считываем request_ из socket_, используя buffer_ для хранения считанных данных
+        http::async_read(socket_, buffer_, request_,
                          // По окончании операции будет вызван метод OnRead
-                         beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
+                         BindRecyclingAllocator(beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis())));
     }
 
-        void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    void OnRead(beast::error_code ec, std::size_t bytes_read) {
         using namespace std::literals;
+        TRACE_ASYNC_END("read", this);
+        reading_ = false;
         if (ec == http::error::end_of_stream) {
-            // Нормальная ситуация - клиент закрыл соединение
-            return Close();
+            // Нормальная ситуация - клиент закрыл соединение.
+            // Если ещё есть неотправленные ответы, соединение закроется после их записи
+            read_closed_ = true;
+            if (write_queue_.empty()) {
+                Close();
+            }
+            return;
+        }
+        if (ec == net::error::operation_aborted) {
+            // Ожидание запроса прервано таймаутом или плавной остановкой
+            return draining_ ? Close() : void();
         }
         if (ec) {
             return ReportError(ec, "read"sv);
         }
-        HandleRequest(std::move(request_));
+        UpdateBufferedBytes();
+        read_at_ = Clock::now();
+        bytes_read_ = bytes_read;
+        request_method_ = http::to_string(request_.method());
+        request_target_.Assign(request_.target());
+        // Обработчик запроса уточнит маршрут вызовом SetRequestRoute
+        SetRequestRoute(UNKNOWN_ROUTE);
+        SetRequestRemoteAddress(remote_address_);
+        if (!request_.keep_alive()) {
+            read_closed_ = true;
+        }
+        if (connections_->IsOverloaded(context_shard_)) {
+            // Сервер не успевает обрабатывать запросы - быстро отказываем и закрываем соединение
+            connections_->OnRequestShed();
+            read_closed_ = true;
+            return Write(MakeOverloadedResponse());
+        }
+        {
+            TRACE_SCOPE("handle");
+            HandleRequest(std::move(request_));
+        }
+        metrics_->RecordDuration(GetRequestRoute(), Metrics::Phase::kHandler, Clock::now() - read_at_);
+        // Не дожидаясь отправки ответа, читаем следующий запрос конвейера
+        ReadIfPossible();
+    }
+
+    HttpRequest MakeRequest() {
+        const RequestAllocator allocator{&pool_};
+        return HttpRequest{std::piecewise_construct, std::make_tuple(allocator), std::make_tuple(allocator)};
+    }
+
+    http::response<http::string_body> MakeOverloadedResponse() const {
+        http::response<http::string_body> response{http::status::service_unavailable, request_.version()};
+        response.set(http::field::content_type, "text/plain"sv);
+        response.set(http::field::retry_after, "1"sv);
+        response.body() = "Service Unavailable"sv;
+        response.keep_alive(false);
+        response.prepare_payload();
+        return response;
+    }
+
+    void UpdateBufferedBytes() {
+        const std::size_t buffered_bytes = sizeof(SessionBase) + buffer_.capacity();
+        connections_->AddBufferedBytes(static_cast<std::ptrdiff_t>(buffered_bytes - buffered_bytes_));
+        buffered_bytes_ = buffered_bytes;
+    }
+
+    void ReadIfPossible() {
+        if (!reading_ && !read_closed_ && write_queue_.size() < MAX_QUEUED_RESPONSES) {
+            Read();
+        }
+    }
+
+    void OnDrain() {
+        draining_ = true;
+        read_closed_ = true;
+        // Простаивающее соединение закрываем сразу. Частично принятый запрос дочитываем
+        // и отвечаем на него. Если ответы ещё пишутся, соединение закроется после них:
+        // отменить только чтение нельзя, socket_.cancel() прервёт и запись
+        if (!write_queue_.empty()) {
+            return;
+        }
+        if (!reading_) {
+            Close();
+        } else if (buffer_.size() == 0) {
+            beast::error_code ec;
+            socket_.cancel(ec);
+        }
     }
 
     void Close() {
         beast::error_code ec;
-        stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+        socket_.shutdown(tcp::socket::shutdown_send, ec);
+    }
+
+    void ArmTimer() {
+        // Перезапуск таймера отменяет предыдущее ожидание. Таймер не продлевает жизнь сессии
+        timer_.expires_after(REQUEST_TIMEOUT);
+        timer_.async_wait(BindRecyclingAllocator([weak_self = GetWeakThis()](beast::error_code ec) {
+            if (auto self = weak_self.lock(); self && !ec) {
+                self->OnTimeout();
+            }
+        }));
+    }
+
+    void OnTimeout() {
+        if (!write_queue_.empty()) {
+            ReportError(beast::error::timeout, "write"sv);
+            Abort();
+        } else if (reading_) {
+            ReportError(beast::error::timeout, "read"sv);
+            Abort();
+        }
+    }
+
+    // Закрывает сокет, прерывая незавершённые чтение и запись. Сессия вернётся в пул,
+    // когда их обработчики отпустят её
+    void Abort() {
+        read_closed_ = true;
+        beast::error_code ec;
+        socket_.close(ec);
     }
 
     // Обработку запроса делегируем подклассу
     virtual void HandleRequest(HttpRequest&& request) = 0;
 
-    void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    void WriteFront() {
+        QueuedWrite& front = *write_queue_.front();
+        TRACE_ASYNC_END("queue", &front);
+        TRACE_ASYNC_BEGIN("write", &front);
+        front.write_started_at = Clock::now();
+        // Пока ответ пишется, таймаут отсчитывается от начала его записи
+        ArmTimer();
+        if (!first_byte_sent_) {
+            first_byte_sent_ = true;
+            metrics_->RecordDuration(front.route, Metrics::Phase::kAcceptToFirstByte,
+                                     front.write_started_at - accepted_at_);
+        }
+        front.Write(*this);
+    }
+
+    void OnWrite(bool close, beast::error_code ec, std::size_t bytes_written) {
+        TRACE_ASYNC_END("write", write_queue_.front().get());
         if (ec) {
-            return ReportError(ec, "write"sv);
+            // Соединение неисправно: следующие ответы отправить не удастся
+            ReportError(ec, "write"sv);
+            return Abort();
         }
+        RecordWrite(*write_queue_.front(), bytes_written);
+        write_queue_.pop_front();
 
         if (close) {
             // Семантика ответа требует закрыть соединение
+            read_closed_ = true;
+            return Close();
+        }
+
+        if (!write_queue_.empty()) {
+            WriteFront();
+        } else if (read_closed_) {
             return Close();
+        } else if (reading_) {
+            // Ответы отправлены, и чтение, начатое во время записи, ждёт следующего запроса
+            ArmTimer();
         }
 
-        // Считываем следующий запрос
-        Read();
+        // В очереди освободилось место - продолжаем чтение, если оно было приостановлено
+        ReadIfPossible();
+    }
+
+    void RecordWrite(const QueuedWrite& write, std::size_t bytes_written) {
+        const auto now = Clock::now();
+        metrics_->RecordDuration(write.route, Metrics::Phase::kWrite, now - write.write_started_at);
+        metrics_->RecordDuration(write.route, Metrics::Phase::kRequest, now - write.read_at);
+        metrics_->RecordResponse(write.route, write.status, write.bytes_read, bytes_written);
+        if (auto* logger = logging::GetLogger()) {
+            logging::LogRecord record;
+            record.kind = logging::LogRecord::Kind::kRequest;
+            record.timestamp = std::chrono::system_clock::now();
+            record.label = write.method;
+            record.text = write.target;
+            record.status = write.status;
+            record.bytes_in = write.bytes_read;
+            record.bytes_out = bytes_written;
+            record.duration = std::chrono::duration_cast<std::chrono::microseconds>(now - write.read_at);
+            logger->Log(record);
+        }
     }
 
     virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
+    virtual std::weak_ptr<SessionBase> GetWeakThis() noexcept = 0;
 };
 
 
@@ -104,8 +564,9 @@ template <typename RequestHandler>
 class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
 public:
     template <typename Handler>
-    Session(tcp::socket&& socket, Handler&& request_handler)
-        : SessionBase(std::move(socket))
+    Session(const Executor& executor, std::shared_ptr<ConnectionManager> connections, ContextShard& shard,
+            std::shared_ptr<Metrics> metrics, Handler&& request_handler)
+        : SessionBase(executor, std::move(connections), shard, std::move(metrics))
         , request_handler_(std::forward<Handler>(request_handler)) {
     }
 
@@ -113,68 +574,246 @@ private:
     RequestHandler request_handler_;
     std::shared_ptr<SessionBase> GetSharedThis() override {
         return this->shared_from_this();
-    }   
+    }
+    std::weak_ptr<SessionBase> GetWeakThis() noexcept override {
+        return this->weak_from_this();
+    }
     void HandleRequest(HttpRequest&& request) override {
-        // Захватываем умный указатель на текущий объект Session в лямбде,
-        // чтобы продлить время жизни сессии до вызова лямбды.
+        // Обработчик вызывает send до возврата из HandleRequest, а сессию в это время
+        // удерживает операция чтения, поэтому лямбде достаточно указателя this.
         // Используется generic-лямбда функция, способная принять response произвольного типа
-        request_handler_(std::move(request), [self = this->shared_from_this()](auto&& response) {
-            self->Write(std::move(response));
+        request_handler_(std::move(request), [this](auto&& response) {
+            this->Write(std::move(response));
         });
     }
 };
 
+// Свободные сессии одного io_context. В режиме kPerCore это пул рабочего потока.
+// Пул - сервис io_context, поэтому разрушается вместе с ним, пока сокеты сессий ещё можно закрыть
+template <typename SessionType>
+class SessionPool : public net::execution_context::service {
+public:
+    // Сколько свободных сессий хранится в пуле. Лишние удаляются
+    static constexpr size_t MAX_FREE_SESSIONS = 1024;
+
+    using key_type = SessionPool;
+    inline static net::execution_context::id id;
+
+    explicit SessionPool(net::execution_context& context)
+        : net::execution_context::service(context) {
+        free_.reserve(MAX_FREE_SESSIONS);
+    }
+
+    // Возвращает свободную сессию или nullptr, если пул пуст
+    std::unique_ptr<SessionType> Acquire() {
+        std::lock_guard lock{mutex_};
+        if (free_.empty()) {
+            return nullptr;
+        }
+        auto session = std::move(free_.back());
+        free_.pop_back();
+        return session;
+    }
+
+    // Сессия должна быть подготовлена к повторному использованию вызовом Reset
+    void Release(std::unique_ptr<SessionType> session) noexcept {
+        std::lock_guard lock{mutex_};
+        if (!shut_down_ && free_.size() < MAX_FREE_SESSIONS) {
+            free_.push_back(std::move(session));
+        }
+        // Иначе сессия удаляется при выходе из функции
+    }
+
+    // Владелец сессий для shared_ptr: когда на сессию не остаётся ссылок,
+    // она снимается с учёта и возвращается в пул
+    struct Recycler {
+        SessionPool* pool;
+
+        void operator()(SessionType* session) const noexcept {
+            session->Finish();
+            session->Reset();
+            pool->Release(std::unique_ptr<SessionType>{session});
+        }
+    };
+
+private:
+    void shutdown() override {
+        std::vector<std::unique_ptr<SessionType>> free;
+        {
+            std::lock_guard lock{mutex_};
+            shut_down_ = true;
+            free.swap(free_);
+        }
+    }
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<SessionType>> free_;
+    bool shut_down_ = false;
+};
+
 template <typename RequestHandler>
-class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
+class Listener : public Drainable, public std::enable_shared_from_this<Listener<RequestHandler>> {
 private:
+    using MySession = Session<RequestHandler>;
+    using MySessionPool = SessionPool<MySession>;
+
+    // Через сколько повторить попытку принять соединение после паузы
+    static constexpr auto ACCEPT_RETRY_DELAY = 10ms;
+
     net::io_context& ioc_;
-    tcp::acceptor acceptor_;
+    MySessionPool& session_pool_;
+    net::basic_socket_acceptor<tcp, StrandExecutor> acceptor_;
+    // Таймер паузы работает на том же strand, что и акцептор
+    StrandTimer accept_timer_{acceptor_.get_executor()};
+    std::shared_ptr<ConnectionManager> connections_;
+    ContextShard& shard_;
+    std::shared_ptr<Metrics> metrics_;
     RequestHandler request_handler_;
+    // Сессия, в сокет которой принимается следующее соединение
+    std::shared_ptr<MySession> pending_session_;
+    bool accept_paused_ = false;
 
 public:
     template <typename Handler>
-    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler,
+             std::shared_ptr<ConnectionManager> connections, std::shared_ptr<Metrics> metrics,
+             bool reuse_port = false)
         : ioc_(ioc)
+        , session_pool_(net::use_service<MySessionPool>(ioc))
         , acceptor_(net::make_strand(ioc))
+        , connections_(std::move(connections))
+        , shard_(connections_->GetShard(ioc))
+        , metrics_(std::move(metrics))
         , request_handler_(std::forward<Handler>(request_handler)) {
         acceptor_.open(endpoint.protocol());
         acceptor_.set_option(net::socket_base::reuse_address(true));
+        if (reuse_port) {
+#ifdef SO_REUSEPORT
+            acceptor_.set_option(ReusePort(true));
+#else
+            throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+        }
         acceptor_.bind(endpoint);
         acceptor_.listen(net::socket_base::max_listen_connections);
     }
     
+    ~Listener() {
+        connections_->Unregister(*this);
+    }
+
+    // Начинает приём соединений. Listener должен принадлежать shared_ptr
     void Run() {
+        connections_->Register(shard_, *this);
         DoAccept();
     }
 
+    tcp::endpoint GetLocalEndpoint() const {
+        return acceptor_.local_endpoint();
+    }
+
+    void Drain() override {
+        auto self = this->weak_from_this().lock();
+        if (!self) {
+            return;
+        }
+        net::post(acceptor_.get_executor(), [self = std::move(self)] {
+            beast::error_code ec;
+            self->accept_timer_.cancel();
+            self->acceptor_.close(ec);
+        });
+    }
+
 private:
     void DoAccept() {
-        acceptor_.async_accept(
-            net::make_strand(ioc_),
-            beast::bind_front_handler(&Listener::OnAccept, this->shared_from_this()));
+        if (!connections_->CanAccept()) {
+            // Лимит сессий или памяти исчерпан. Новые соединения ждут в очереди listen,
+            // пока часть сессий не завершится
+            return PauseAccept();
+        }
+        accept_paused_ = false;
+        pending_session_ = AcquireSession();
+        acceptor_.async_accept(pending_session_->GetSocket(), BindRecyclingAllocator(beast::bind_front_handler(
+                                                               &Listener::OnAccept, this->shared_from_this())));
+    }
+
+    std::shared_ptr<MySession> AcquireSession() {
+        std::unique_ptr<MySession> session = session_pool_.Acquire();
+        if (!session) {
+            session = std::make_unique<MySession>(net::make_strand(ioc_), connections_, shard_, metrics_,
+                                                  request_handler_);
+        }
+        // Блок управления shared_ptr тоже не возвращается в кучу, а переиспользуется
+        return std::shared_ptr<MySession>(session.release(), typename MySessionPool::Recycler{&session_pool_},
+                                          RecyclingAllocator<MySession>{});
+    }
+
+    void PauseAccept() {
+        if (!accept_paused_) {
+            accept_paused_ = true;
+            connections_->OnAcceptPaused();
+        }
+        accept_timer_.expires_after(ACCEPT_RETRY_DELAY);
+        accept_timer_.async_wait(BindRecyclingAllocator([self = this->shared_from_this()](beast::error_code ec) {
+            if (!ec) {
+                self->DoAccept();
+            }
+        }));
     }
     
-    void OnAccept(beast::error_code ec, tcp::socket socket) {
+    void OnAccept(beast::error_code ec) {
         using namespace std::literals;
+        TRACE_SCOPE("accept");
 
+        // Если соединение не будет обслуживаться, сессия вернётся в пул при выходе из функции
+        const auto session = std::move(pending_session_);
+        if (ec == net::error::operation_aborted) {
+            return;
+        }
         if (ec) {
-            return ReportError(ec, "accept"sv);
+            // Например, закончились файловые дескрипторы. Не прекращаем приём насовсем,
+            // а повторяем попытку после паузы
+            ReportError(ec, "accept"sv);
+            connections_->OnAcceptError();
+            return PauseAccept();
+        }
+        beast::error_code endpoint_ec;
+        const auto address = session->GetSocket().remote_endpoint(endpoint_ec).address();
+        if (!endpoint_ec && connections_->TryAdmit(address)) {
+            session->Start(address);
+        }
+        if (acceptor_.is_open()) {
+            DoAccept();
         }
-        AsyncRunSession(std::move(socket));
-        DoAccept();
-    }
-
-    void AsyncRunSession(tcp::socket&& socket) {
-        std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
     }
 };
 
 template <typename RequestHandler>
-void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler,
+               std::shared_ptr<ConnectionManager> connections = std::make_shared<ConnectionManager>(),
+               std::shared_ptr<Metrics> metrics = std::make_shared<Metrics>()) {
+    using MyListener = Listener<std::decay_t<RequestHandler>>;
+
+    auto listener = std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler), connections,
+                                                 std::move(metrics));
+    listener->Run();
+}
+
+template <typename RequestHandler>
+void ServeHttp(IoContextPool& pool, const tcp::endpoint& endpoint, RequestHandler&& handler,
+               std::shared_ptr<ConnectionManager> connections, std::shared_ptr<Metrics> metrics) {
     using MyListener = Listener<std::decay_t<RequestHandler>>;
 
-    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
-    // Напишите недостающий код, используя информацию из урока
+    if (pool.GetMode() == IoContextPool::Mode::kShared) {
+        return ServeHttp(pool.GetContext(0), endpoint, std::forward<RequestHandler>(handler), std::move(connections),
+                         std::move(metrics));
+    }
+    // Каждый io_context получает свой акцептор на общем порту и свою копию обработчика.
+    // Лимиты соединений общие для всех акцепторов
+    for (size_t i = 0; i < pool.Size(); ++i) {
+        auto listener = std::make_shared<MyListener>(pool.GetContext(i), endpoint, handler, connections, metrics, true);
+        listener->Run();
+    }
 }
 
 }  // namespace http_server
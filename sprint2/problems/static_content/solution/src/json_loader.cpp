@@ -1,4 +1,6 @@
 #include "json_loader.h"
+#include "binary_encoding.h"
+#include "etag.h"
 #include <fstream>
 #include <boost/json.hpp>
 #include <iostream>
@@ -83,6 +85,63 @@ model::Map LoadMap(const json::object& map_obj) {
     return map;
 }
 
+// Сериализация карты в формат ответа на GET /api/v1/maps/{id}
+json::object SerializeMap(const model::Map& map) {
+    json::object map_obj;
+    map_obj["id"] = *map.GetId();
+    map_obj["name"] = map.GetName();
+
+    json::array roads;
+    for (const auto& road : map.GetRoads()) {
+        json::object road_obj;
+        road_obj["x0"] = road.GetStart().x;
+        road_obj["y0"] = road.GetStart().y;
+        if (road.IsHorizontal()) {
+            road_obj["x1"] = road.GetEnd().x;
+        } else {
+            road_obj["y1"] = road.GetEnd().y;
+        }
+        roads.push_back(std::move(road_obj));
+    }
+    map_obj["roads"] = std::move(roads);
+
+    json::array buildings;
+    for (const auto& building : map.GetBuildings()) {
+        const auto& bounds = building.GetBounds();
+        json::object building_obj;
+        building_obj["x"] = bounds.position.x;
+        building_obj["y"] = bounds.position.y;
+        building_obj["w"] = bounds.size.width;
+        building_obj["h"] = bounds.size.height;
+        buildings.push_back(std::move(building_obj));
+    }
+    map_obj["buildings"] = std::move(buildings);
+
+    json::array offices;
+    for (const auto& office : map.GetOffices()) {
+        json::object office_obj;
+        office_obj["id"] = *office.GetId();
+        office_obj["x"] = office.GetPosition().x;
+        office_obj["y"] = office.GetPosition().y;
+        office_obj["offsetX"] = office.GetOffset().dx;
+        office_obj["offsetY"] = office.GetOffset().dy;
+        offices.push_back(std::move(office_obj));
+    }
+    map_obj["offices"] = std::move(offices);
+
+    return map_obj;
+}
+
+model::Serialized MakeSerialized(std::string content) {
+    auto data = std::make_shared<const std::string>(std::move(content));
+    std::string etag = util::MakeETag(*data);
+    return {std::move(data), std::move(etag)};
+}
+
+model::Serialized MakeSerialized(const json::value& value) {
+    return MakeSerialized(json::serialize(value));
+}
+
 } // namespace
 
 model::Game LoadGame(const std::filesystem::path& json_path) {
@@ -104,10 +163,22 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
 
     model::Game game;
 
-    // 4. Обрабатываем каждую карту
+    // 4. Обрабатываем каждую карту. Карты не меняются после загрузки,
+    // поэтому их JSON- и двоичное представления строятся один раз
+    json::array maps_list;
     for (auto& map_value : maps_array) {
-        game.AddMap(LoadMap(map_value.as_object()));
+        model::Map map = LoadMap(map_value.as_object());
+        map.SetSerialized(MakeSerialized(SerializeMap(map)));
+        map.SetSerializedBinary(MakeSerialized(binary_encoding::EncodeMap(map)));
+
+        json::object map_item;
+        map_item["id"] = *map.GetId();
+        map_item["name"] = map.GetName();
+        maps_list.push_back(std::move(map_item));
+
+        game.AddMap(std::move(map));
     }
+    game.SetSerializedMaps(MakeSerialized(maps_list));
 
     return game;
 }
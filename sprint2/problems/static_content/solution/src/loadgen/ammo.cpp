@@ -0,0 +1,86 @@
+#include "ammo.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "../header_values.h"
+
+namespace loadgen {
+
+using namespace std::literals;
+
+namespace {
+
+using util::EqualsIgnoreCase;
+
+// Строки файла могут оканчиваться на \r\n
+std::string_view Trim(std::string_view value) {
+    return util::Trim(value, " \t\r"sv);
+}
+
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+void SetHeader(Headers& headers, std::string_view line) {
+    const auto colon = line.find(':');
+    if (colon == std::string_view::npos) {
+        throw std::invalid_argument("Invalid ammo header: "s + std::string(line));
+    }
+    const std::string_view name = Trim(line.substr(0, colon));
+    const std::string_view value = Trim(line.substr(colon + 1));
+    const auto it = std::find_if(headers.begin(), headers.end(), [name](const auto& header) {
+        return EqualsIgnoreCase(header.first, name);
+    });
+    if (it != headers.end()) {
+        it->second = value;
+    } else {
+        headers.emplace_back(name, value);
+    }
+}
+
+std::string SerializeRequest(std::string_view uri, const Headers& headers, std::string_view default_host) {
+    std::string data;
+    data.append("GET "sv).append(uri).append(" HTTP/1.1\r\n"sv);
+    bool has_host = false;
+    for (const auto& [name, value] : headers) {
+        has_host = has_host || EqualsIgnoreCase(name, "Host"sv);
+        data.append(name).append(": "sv).append(value).append("\r\n"sv);
+    }
+    if (!has_host) {
+        data.append("Host: "sv).append(default_host).append("\r\n"sv);
+    }
+    data.append("\r\n"sv);
+    return data;
+}
+
+}  // namespace
+
+std::vector<AmmoRequest> LoadAmmo(std::istream& input, std::string_view default_host) {
+    std::vector<AmmoRequest> requests;
+    Headers headers;
+    std::string raw_line;
+    while (std::getline(input, raw_line)) {
+        const std::string_view line = Trim(raw_line);
+        if (line.empty()) {
+            continue;
+        }
+        if (line.front() == '[' && line.back() == ']') {
+            SetHeader(headers, line.substr(1, line.size() - 2));
+            continue;
+        }
+        const auto space = line.find_first_of(" \t"sv);
+        AmmoRequest request;
+        request.uri = line.substr(0, space);
+        if (space != std::string_view::npos) {
+            request.tag = Trim(line.substr(space));
+        }
+        request.data = SerializeRequest(request.uri, headers, default_host);
+        requests.push_back(std::move(request));
+    }
+    if (requests.empty()) {
+        throw std::invalid_argument("Ammo file contains no requests");
+    }
+    return requests;
+}
+
+}  // namespace loadgen
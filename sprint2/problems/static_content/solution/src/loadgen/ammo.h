@@ -0,0 +1,25 @@
+#pragma once
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace loadgen {
+
+// Запрос из файла патронов, заранее сериализованный в HTTP/1.1
+struct AmmoRequest {
+    std::string uri;
+    // Необязательная метка из второй колонки файла
+    std::string tag;
+    std::string data;
+};
+
+// Читает патроны в формате uri, как у phantom (Yandex.Tank):
+//   [Header: value]   - заголовок для всех последующих запросов, повторный заголовок с тем же
+//                       именем заменяет прежний;
+//   /path [tag]       - GET-запрос.
+// Если в файле нет заголовка Host, используется default_host.
+// Бросает std::invalid_argument, если в файле нет ни одного запроса
+std::vector<AmmoRequest> LoadAmmo(std::istream& input, std::string_view default_host);
+
+}  // namespace loadgen
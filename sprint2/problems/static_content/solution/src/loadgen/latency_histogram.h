@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace loadgen {
+
+// Гистограмма задержек с логарифмически-линейными корзинами, как в HdrHistogram.
+// Значения до 128 нс хранятся точно, остальные - с относительной погрешностью не более 1/64.
+// Поэтому p99 и p999 не огрубляются до степеней двойки, а память не растёт с числом запросов
+class LatencyHistogram {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    LatencyHistogram()
+        : buckets_(BUCKET_COUNT) {
+    }
+
+    void Record(Duration duration) noexcept {
+        const auto value = static_cast<std::uint64_t>(std::max<Duration::rep>(duration.count(), 0));
+        ++buckets_[GetBucket(value)];
+        ++count_;
+        sum_ += value;
+        max_ = std::max(max_, value);
+    }
+
+    void Merge(const LatencyHistogram& other) noexcept {
+        for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    std::uint64_t GetCount() const noexcept {
+        return count_;
+    }
+
+    // Значение, которое не превышают доля quantile (от 0 до 1) измерений, в наносекундах
+    double GetPercentile(double quantile) const noexcept {
+        if (count_ == 0) {
+            return 0;
+        }
+        const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(quantile * count_)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                return std::min(GetBucketMiddle(i), static_cast<double>(max_));
+            }
+        }
+        return static_cast<double>(max_);
+    }
+
+    double GetMean() const noexcept {
+        return count_ == 0 ? 0 : static_cast<double>(sum_) / count_;
+    }
+
+    std::uint64_t GetMax() const noexcept {
+        return max_;
+    }
+
+private:
+    static constexpr unsigned SUB_BUCKET_BITS = 6;
+    static constexpr std::uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    // Значения меньше LINEAR_LIMIT попадают каждое в свою корзину
+    static constexpr std::uint64_t LINEAR_LIMIT = SUB_BUCKETS * 2;
+    static constexpr unsigned FIRST_EXPONENT = SUB_BUCKET_BITS + 1;
+    static constexpr std::size_t BUCKET_COUNT = LINEAR_LIMIT + (64 - FIRST_EXPONENT) * SUB_BUCKETS;
+
+    static std::size_t GetBucket(std::uint64_t value) noexcept {
+        if (value < LINEAR_LIMIT) {
+            return value;
+        }
+        const unsigned exponent = std::bit_width(value) - 1;
+        const std::uint64_t sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+        return LINEAR_LIMIT + (exponent - FIRST_EXPONENT) * SUB_BUCKETS + sub_bucket;
+    }
+
+    static double GetBucketMiddle(std::size_t bucket) noexcept {
+        if (bucket < LINEAR_LIMIT) {
+            return static_cast<double>(bucket);
+        }
+        const unsigned exponent = FIRST_EXPONENT + (bucket - LINEAR_LIMIT) / SUB_BUCKETS;
+        const std::uint64_t sub_bucket = (bucket - LINEAR_LIMIT) % SUB_BUCKETS;
+        const std::uint64_t width = std::uint64_t{1} << (exponent - SUB_BUCKET_BITS);
+        return static_cast<double>((SUB_BUCKETS + sub_bucket) * width) + width / 2.0;
+    }
+
+    std::vector<std::uint64_t> buckets_;
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t max_ = 0;
+};
+
+}  // namespace loadgen
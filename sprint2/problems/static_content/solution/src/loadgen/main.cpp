@@ -0,0 +1,201 @@
+#include <boost/asio/ip/tcp.hpp>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ammo.h"
+#include "schedule.h"
+#include "worker.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct Args {
+    std::string host;
+    std::string port;
+    std::string ammo_file;
+    std::string schedule;
+    std::size_t connections = 8;
+    unsigned threads = 1;
+    std::chrono::milliseconds timeout{10'000};
+    // Файл отчёта. Если не задан, отчёт выводится в stdout
+    std::string output;
+};
+
+// Разбирает неотрицательное целое число. Возвращает std::nullopt, если value не число целиком
+// или не помещается в T
+template <typename T>
+std::optional<T> ParseUnsigned(std::string_view value) {
+    T number{};
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), number);
+    if (ec != std::errc{} || end != value.data() + value.size()) {
+        return std::nullopt;
+    }
+    return number;
+}
+
+// Разбирает аргументы командной строки. При ошибке возвращает std::nullopt
+std::optional<Args> ParseCommandLine(int argc, const char* argv[]) {
+    if (argc < 4) {
+        return std::nullopt;
+    }
+    Args args;
+    const std::string_view address = argv[1];
+    const auto colon = address.rfind(':');
+    if (colon == std::string_view::npos || colon == 0 || colon + 1 == address.size()) {
+        return std::nullopt;
+    }
+    args.host = address.substr(0, colon);
+    args.port = address.substr(colon + 1);
+    args.ammo_file = argv[2];
+    args.schedule = argv[3];
+    for (int i = 4; i < argc; ++i) {
+        const std::string_view option = argv[i];
+        if (option == "--connections"sv && i + 1 < argc) {
+            const auto connections = ParseUnsigned<std::size_t>(argv[++i]);
+            if (!connections) {
+                return std::nullopt;
+            }
+            args.connections = std::max<std::size_t>(1, *connections);
+        } else if (option == "--threads"sv && i + 1 < argc) {
+            const auto threads = ParseUnsigned<unsigned>(argv[++i]);
+            if (!threads) {
+                return std::nullopt;
+            }
+            args.threads = std::max(1u, *threads);
+        } else if (option == "--timeout-ms"sv && i + 1 < argc) {
+            const auto timeout = ParseUnsigned<std::uint32_t>(argv[++i]);
+            if (!timeout) {
+                return std::nullopt;
+            }
+            args.timeout = std::chrono::milliseconds{*timeout};
+        } else if (option == "--output"sv && i + 1 < argc) {
+            args.output = argv[++i];
+        } else {
+            return std::nullopt;
+        }
+    }
+    return args;
+}
+
+void WriteEscaped(std::ostream& out, std::string_view value) {
+    out << '"';
+    for (const char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+// Процентили в микросекундах с точностью до десятых
+void WriteLatency(std::ostream& out, const loadgen::LatencyHistogram& histogram) {
+    const auto us = [](double ns) {
+        return std::round(ns / 100) / 10;
+    };
+    out << "{\"mean\":" << us(histogram.GetMean()) << ",\"p50\":" << us(histogram.GetPercentile(0.5))
+        << ",\"p90\":" << us(histogram.GetPercentile(0.9)) << ",\"p99\":" << us(histogram.GetPercentile(0.99))
+        << ",\"p999\":" << us(histogram.GetPercentile(0.999))
+        << ",\"max\":" << us(static_cast<double>(histogram.GetMax())) << '}';
+}
+
+void WriteReport(std::ostream& out, const Args& args, unsigned threads, const loadgen::Stats& stats,
+                 double elapsed) {
+    const std::uint64_t completed = stats.latency.GetCount();
+    out << std::fixed << std::setprecision(1);
+    out << "{\"schedule\":";
+    WriteEscaped(out, args.schedule);
+    out << ",\"connections\":" << args.connections << ",\"threads\":" << threads
+        << ",\"elapsed_s\":" << std::setprecision(3) << elapsed << std::setprecision(1)
+        << ",\"scheduled\":" << stats.scheduled << ",\"completed\":" << completed << ",\"unsent\":" << stats.unsent
+        << ",\"throughput_rps\":" << (elapsed > 0 ? completed / elapsed : 0.0)
+        << ",\"bytes_received\":" << stats.bytes_received << ",\"max_backlog\":" << stats.max_backlog
+        << ",\"latency_us\":";
+    WriteLatency(out, stats.latency);
+    out << ",\"service_time_us\":";
+    WriteLatency(out, stats.service_time);
+    out << ",\"status_codes\":{";
+    bool first = true;
+    for (const auto& [status, count] : stats.statuses) {
+        out << (first ? "" : ",") << '"' << status << "\":" << count;
+        first = false;
+    }
+    out << "},\"errors\":{\"connect\":" << stats.connect_errors << ",\"write\":" << stats.write_errors
+        << ",\"read\":" << stats.read_errors << ",\"timeout\":" << stats.timeouts << "}}\n";
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    const auto args = ParseCommandLine(argc, argv);
+    if (!args) {
+        std::cerr << "Usage: loadgen <host:port> <ammo-file> <schedule> "
+                     "[--connections <n>] [--threads <n>] [--timeout-ms <ms>] [--output <path>]\n"
+                     "Schedule example: \"line(5, 30, 1m) const(30, 30s)\""sv
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    try {
+        const auto schedule = loadgen::Schedule::Parse(args->schedule);
+
+        std::ifstream ammo_file(args->ammo_file);
+        if (!ammo_file) {
+            throw std::runtime_error("Failed to open ammo file " + args->ammo_file);
+        }
+        const auto ammo = loadgen::LoadAmmo(ammo_file, args->host + ':' + args->port);
+
+        loadgen::WorkerOptions options;
+        {
+            loadgen::net::io_context ioc;
+            loadgen::tcp::resolver resolver{ioc};
+            options.endpoint = *resolver.resolve(args->host, args->port).begin();
+        }
+        options.timeout = args->timeout;
+
+        // Соединения распределяются между потоками поровну
+        const unsigned threads = static_cast<unsigned>(std::min<std::size_t>(args->threads, args->connections));
+        std::vector<std::unique_ptr<loadgen::Worker>> workers;
+        for (unsigned i = 0; i < threads; ++i) {
+            options.connections = args->connections / threads + (i < args->connections % threads ? 1 : 0);
+            workers.push_back(std::make_unique<loadgen::Worker>(options, ammo, schedule, i, threads));
+        }
+
+        // Общий момент старта с запасом на запуск потоков и установку соединений
+        const auto start = loadgen::Clock::now() + 200ms;
+        std::vector<std::thread> running;
+        for (auto& worker : workers) {
+            running.emplace_back([&worker, start] {
+                worker->Run(start);
+            });
+        }
+        for (auto& thread : running) {
+            thread.join();
+        }
+        const double elapsed = std::chrono::duration<double>(loadgen::Clock::now() - start).count();
+
+        loadgen::Stats stats;
+        for (const auto& worker : workers) {
+            stats.Merge(worker->GetStats());
+        }
+        if (args->output.empty()) {
+            WriteReport(std::cout, *args, threads, stats, elapsed);
+        } else {
+            std::ofstream output(args->output);
+            WriteReport(output, *args, threads, stats, elapsed);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
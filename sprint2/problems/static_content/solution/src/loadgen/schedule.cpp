@@ -0,0 +1,141 @@
+#include "schedule.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "../header_values.h"
+
+namespace loadgen {
+
+using namespace std::literals;
+
+namespace {
+
+using util::Trim;
+
+double ParseNumber(std::string_view text) {
+    const std::string value{Trim(text)};
+    std::size_t parsed = 0;
+    double number = -1;
+    try {
+        number = std::stod(value, &parsed);
+    } catch (const std::exception&) {
+    }
+    if (parsed == 0 || parsed != value.size() || number < 0) {
+        throw std::invalid_argument("Invalid number in schedule: "s + value);
+    }
+    return number;
+}
+
+double ParseDuration(std::string_view text) {
+    text = Trim(text);
+    const auto unit_begin = text.find_first_not_of("0123456789."sv);
+    const double value = ParseNumber(text.substr(0, unit_begin));
+    const std::string_view unit = unit_begin == std::string_view::npos ? ""sv : Trim(text.substr(unit_begin));
+    if (unit.empty() || unit == "s"sv) {
+        return value;
+    }
+    if (unit == "ms"sv) {
+        return value / 1000;
+    }
+    if (unit == "m"sv) {
+        return value * 60;
+    }
+    if (unit == "h"sv) {
+        return value * 3600;
+    }
+    throw std::invalid_argument("Invalid duration unit in schedule: "s + std::string(unit));
+}
+
+std::vector<std::string_view> SplitArguments(std::string_view text) {
+    std::vector<std::string_view> arguments;
+    while (true) {
+        const auto comma = text.find(',');
+        arguments.push_back(Trim(text.substr(0, comma)));
+        if (comma == std::string_view::npos) {
+            return arguments;
+        }
+        text.remove_prefix(comma + 1);
+    }
+}
+
+}  // namespace
+
+Schedule Schedule::Parse(std::string_view text) {
+    Schedule schedule;
+    while (!(text = Trim(text)).empty()) {
+        const auto open = text.find('(');
+        const auto close = text.find(')');
+        if (open == std::string_view::npos || close == std::string_view::npos || close < open) {
+            throw std::invalid_argument("Invalid schedule: "s + std::string(text));
+        }
+        const std::string_view kind = Trim(text.substr(0, open));
+        const auto arguments = SplitArguments(text.substr(open + 1, close - open - 1));
+        if (kind == "line"sv && arguments.size() == 3) {
+            schedule.steps_.push_back(
+                {ParseNumber(arguments[0]), ParseNumber(arguments[1]), ParseDuration(arguments[2])});
+        } else if (kind == "const"sv && arguments.size() == 2) {
+            const double rps = ParseNumber(arguments[0]);
+            schedule.steps_.push_back({rps, rps, ParseDuration(arguments[1])});
+        } else {
+            throw std::invalid_argument("Unknown schedule step: "s + std::string(text.substr(0, close + 1)));
+        }
+        text.remove_prefix(close + 1);
+    }
+    if (schedule.steps_.empty()) {
+        throw std::invalid_argument("Empty schedule");
+    }
+    return schedule;
+}
+
+double Schedule::GetDuration() const noexcept {
+    double duration = 0;
+    for (const Step& step : steps_) {
+        duration += step.duration;
+    }
+    return duration;
+}
+
+double Schedule::CountWithin(const Step& step, double t) noexcept {
+    if (step.duration == 0) {
+        return 0;
+    }
+    // Интеграл линейно меняющейся нагрузки: a*t + (b - a)*t^2 / (2*T)
+    return step.from_rps * t + (step.to_rps - step.from_rps) * t * t / (2 * step.duration);
+}
+
+double Schedule::CountAt(double t) const noexcept {
+    double count = 0;
+    for (const Step& step : steps_) {
+        if (t <= step.duration) {
+            return count + CountWithin(step, std::max(t, 0.0));
+        }
+        count += CountWithin(step, step.duration);
+        t -= step.duration;
+    }
+    return count;
+}
+
+double Schedule::TimeOf(double n) const noexcept {
+    double start = 0;
+    for (const Step& step : steps_) {
+        const double step_count = CountWithin(step, step.duration);
+        if (n < step_count) {
+            if (n <= 0) {
+                return start;
+            }
+            // Корень уравнения a*t + k*t^2/2 = n в форме, устойчивой при k, близком к нулю
+            const double a = step.from_rps;
+            const double k = (step.to_rps - step.from_rps) / step.duration;
+            return start + 2 * n / (a + std::sqrt(std::max(a * a + 2 * k * n, 0.0)));
+        }
+        n -= step_count;
+        start += step.duration;
+    }
+    return std::numeric_limits<double>::infinity();
+}
+
+}  // namespace loadgen
@@ -0,0 +1,40 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+namespace loadgen {
+
+// Профиль нагрузки в запросах в секунду в синтаксисе phantom (Yandex.Tank).
+// Шаги выполняются друг за другом:
+//   line(a, b, duration) - нагрузка линейно растёт (или падает) от a до b rps;
+//   const(a, duration)   - постоянная нагрузка a rps.
+// Длительность задаётся числом с единицей ms, s, m или h; число без единицы означает секунды.
+// Например: "line(5, 30, 1m) const(30, 30s)"
+class Schedule {
+public:
+    // Бросает std::invalid_argument, если профиль задан неверно
+    static Schedule Parse(std::string_view text);
+
+    // Длительность профиля в секундах
+    double GetDuration() const noexcept;
+
+    // Сколько запросов должно быть отправлено к моменту t секунд от начала
+    double CountAt(double t) const noexcept;
+
+    // Момент в секундах от начала, когда должен быть отправлен запрос с номером n (с нуля).
+    // Для запросов за пределами профиля возвращает бесконечность
+    double TimeOf(double n) const noexcept;
+
+private:
+    struct Step {
+        double from_rps;
+        double to_rps;
+        double duration;
+    };
+
+    static double CountWithin(const Step& step, double t) noexcept;
+
+    std::vector<Step> steps_;
+};
+
+}  // namespace loadgen
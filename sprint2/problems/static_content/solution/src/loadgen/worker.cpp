@@ -0,0 +1,191 @@
+#include "worker.h"
+
+#include <cmath>
+#include <limits>
+
+namespace loadgen {
+
+void Stats::Merge(const Stats& other) {
+    latency.Merge(other.latency);
+    service_time.Merge(other.service_time);
+    for (const auto& [status, count] : other.statuses) {
+        statuses[status] += count;
+    }
+    scheduled += other.scheduled;
+    unsent += other.unsent;
+    connect_errors += other.connect_errors;
+    write_errors += other.write_errors;
+    read_errors += other.read_errors;
+    timeouts += other.timeouts;
+    bytes_received += other.bytes_received;
+    max_backlog = std::max(max_backlog, other.max_backlog);
+}
+
+Worker::Worker(WorkerOptions options, const std::vector<AmmoRequest>& ammo, const Schedule& schedule,
+               unsigned index, unsigned worker_count)
+    : options_(std::move(options))
+    , ammo_(ammo)
+    , schedule_(schedule)
+    , worker_count_(worker_count)
+    , next_request_(index)
+    , next_ammo_(index) {
+    connections_.reserve(options_.connections);
+    idle_.reserve(options_.connections);
+    for (std::size_t i = 0; i < options_.connections; ++i) {
+        connections_.push_back(std::make_unique<Connection>(ioc_));
+    }
+}
+
+void Worker::Run(Clock::time_point start) {
+    start_ = start;
+    // Соединения устанавливаются заранее, чтобы первые запросы не ждали connect
+    for (const auto& connection : connections_) {
+        Connect(*connection);
+    }
+    ScheduleNext();
+    ioc_.run();
+}
+
+void Worker::Connect(Connection& connection) {
+    connection.stream.expires_after(options_.timeout);
+    connection.stream.async_connect(options_.endpoint, [this, &connection](beast::error_code ec) {
+        if (ec) {
+            CountError(ec, stats_.connect_errors);
+        } else {
+            connection.connected = true;
+        }
+        // Пока шло подключение, запросы могли накопиться в очереди
+        Release(connection);
+    });
+}
+
+void Worker::ScheduleNext() {
+    const double due = schedule_.TimeOf(static_cast<double>(next_request_));
+    if (!std::isfinite(due)) {
+        // Профиль закончился. Запросы, так и не дождавшиеся соединения, уже не отправляются
+        scheduling_done_ = true;
+        stats_.unsent += backlog_.size();
+        backlog_.clear();
+        return CloseIfDone();
+    }
+    timer_.expires_at(start_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(due)));
+    timer_.async_wait([this](beast::error_code ec) {
+        if (ec) {
+            return;
+        }
+        const auto now = Clock::now();
+        while (true) {
+            const double due = schedule_.TimeOf(static_cast<double>(next_request_));
+            if (!std::isfinite(due)) {
+                break;
+            }
+            const auto scheduled_at =
+                start_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(due));
+            if (scheduled_at > now) {
+                break;
+            }
+            Dispatch(scheduled_at);
+            next_request_ += worker_count_;
+        }
+        ScheduleNext();
+    });
+}
+
+void Worker::Dispatch(Clock::time_point scheduled_at) {
+    ++stats_.scheduled;
+    if (idle_.empty()) {
+        backlog_.push_back(scheduled_at);
+        stats_.max_backlog = std::max(stats_.max_backlog, backlog_.size());
+        return;
+    }
+    Connection& connection = *idle_.back();
+    idle_.pop_back();
+    Issue(connection, scheduled_at);
+}
+
+void Worker::Issue(Connection& connection, Clock::time_point scheduled_at) {
+    ++in_flight_;
+    connection.scheduled_at = scheduled_at;
+    connection.request = &ammo_[next_ammo_++ % ammo_.size()];
+    if (connection.connected) {
+        return Send(connection);
+    }
+    connection.stream.expires_after(options_.timeout);
+    connection.stream.async_connect(options_.endpoint, [this, &connection](beast::error_code ec) {
+        if (ec) {
+            CountError(ec, stats_.connect_errors);
+            return Finish(connection, false);
+        }
+        connection.connected = true;
+        Send(connection);
+    });
+}
+
+void Worker::Send(Connection& connection) {
+    connection.sent_at = Clock::now();
+    connection.stream.expires_after(options_.timeout);
+    net::async_write(connection.stream, net::buffer(connection.request->data),
+                     [this, &connection](beast::error_code ec, std::size_t) {
+                         if (ec) {
+                             CountError(ec, stats_.write_errors);
+                             return Finish(connection, false);
+                         }
+                         Read(connection);
+                     });
+}
+
+void Worker::Read(Connection& connection) {
+    connection.parser.emplace();
+    connection.parser->body_limit(std::numeric_limits<std::uint64_t>::max());
+    http::async_read(connection.stream, connection.buffer, *connection.parser,
+                     [this, &connection](beast::error_code ec, std::size_t bytes) {
+                         if (ec) {
+                             CountError(ec, stats_.read_errors);
+                             return Finish(connection, false);
+                         }
+                         const auto now = Clock::now();
+                         stats_.latency.Record(now - connection.scheduled_at);
+                         stats_.service_time.Record(now - connection.sent_at);
+                         const auto& response = connection.parser->get();
+                         ++stats_.statuses[response.result_int()];
+                         stats_.bytes_received += bytes;
+                         Finish(connection, response.keep_alive());
+                     });
+}
+
+void Worker::Finish(Connection& connection, bool keep_alive) {
+    --in_flight_;
+    connection.parser.reset();
+    if (!keep_alive) {
+        connection.stream.close();
+        connection.buffer.clear();
+        connection.connected = false;
+    }
+    Release(connection);
+}
+
+void Worker::Release(Connection& connection) {
+    if (!backlog_.empty()) {
+        const auto scheduled_at = backlog_.front();
+        backlog_.pop_front();
+        return Issue(connection, scheduled_at);
+    }
+    idle_.push_back(&connection);
+    CloseIfDone();
+}
+
+void Worker::CountError(beast::error_code ec, std::uint64_t& counter) noexcept {
+    ++(ec == beast::error::timeout ? stats_.timeouts : counter);
+}
+
+void Worker::CloseIfDone() {
+    if (!scheduling_done_ || in_flight_ != 0) {
+        return;
+    }
+    // Закрытие прерывает незавершённые предварительные подключения, и io_context останавливается
+    for (const auto& connection : connections_) {
+        connection->stream.close();
+    }
+}
+
+}  // namespace loadgen
@@ -0,0 +1,122 @@
+#pragma once
+#include "ammo.h"
+#include "latency_histogram.h"
+#include "schedule.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace loadgen {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+struct WorkerOptions {
+    tcp::endpoint endpoint;
+    std::size_t connections = 1;
+    // Предельное время установки соединения, отправки запроса и получения ответа
+    std::chrono::milliseconds timeout{10'000};
+};
+
+// Итоги нагрузки одного или нескольких рабочих потоков
+struct Stats {
+    // От момента, на который запрос был запланирован, до получения ответа. Включает ожидание
+    // свободного соединения, поэтому перегрузка сервера не маскируется (coordinated omission)
+    LatencyHistogram latency;
+    // От фактической отправки запроса до получения ответа. Сопоставимо с задержкой,
+    // которую измеряет сам сервер
+    LatencyHistogram service_time;
+    std::map<unsigned, std::uint64_t> statuses;
+    std::uint64_t scheduled = 0;
+    // Запланированные запросы, для которых до конца профиля не нашлось свободного соединения
+    std::uint64_t unsent = 0;
+    std::uint64_t connect_errors = 0;
+    std::uint64_t write_errors = 0;
+    std::uint64_t read_errors = 0;
+    std::uint64_t timeouts = 0;
+    std::uint64_t bytes_received = 0;
+    // Наибольшее число запросов, ожидавших свободного соединения
+    std::size_t max_backlog = 0;
+
+    void Merge(const Stats& other);
+};
+
+// Рабочий поток нагрузки. Владеет своим io_context и соединениями и отправляет запросы
+// с номерами index, index + worker_count, ... в моменты, которые задаёт профиль.
+// Запросы не конвейеризуются: в каждом keep-alive соединении не больше одного запроса
+class Worker {
+public:
+    Worker(WorkerOptions options, const std::vector<AmmoRequest>& ammo, const Schedule& schedule, unsigned index,
+           unsigned worker_count);
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    // Выполняет профиль, отсчитывая время от start. Возвращает управление, когда профиль
+    // закончился и на все отправленные запросы получены ответы или истёк таймаут
+    void Run(Clock::time_point start);
+
+    const Stats& GetStats() const noexcept {
+        return stats_;
+    }
+
+private:
+    struct Connection {
+        explicit Connection(net::io_context& ioc)
+            : stream(ioc) {
+        }
+
+        beast::tcp_stream stream;
+        beast::flat_buffer buffer;
+        std::optional<http::response_parser<http::string_body>> parser;
+        bool connected = false;
+        const AmmoRequest* request = nullptr;
+        Clock::time_point scheduled_at;
+        Clock::time_point sent_at;
+    };
+
+    void Connect(Connection& connection);
+    void ScheduleNext();
+    void Dispatch(Clock::time_point scheduled_at);
+    void Issue(Connection& connection, Clock::time_point scheduled_at);
+    void Send(Connection& connection);
+    void Read(Connection& connection);
+    void Finish(Connection& connection, bool keep_alive);
+    // Отдаёт свободное соединение первому запросу из очереди или возвращает в список свободных
+    void Release(Connection& connection);
+    void CountError(beast::error_code ec, std::uint64_t& counter) noexcept;
+    void CloseIfDone();
+
+    net::io_context ioc_{1};
+    WorkerOptions options_;
+    const std::vector<AmmoRequest>& ammo_;
+    const Schedule& schedule_;
+    unsigned worker_count_;
+    std::uint64_t next_request_;
+    std::size_t next_ammo_;
+
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::vector<Connection*> idle_;
+    std::deque<Clock::time_point> backlog_;
+    net::steady_timer timer_{ioc_};
+    Clock::time_point start_;
+    std::size_t in_flight_ = 0;
+    bool scheduling_done_ = false;
+
+    Stats stats_;
+};
+
+}  // namespace loadgen
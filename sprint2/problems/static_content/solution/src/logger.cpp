@@ -0,0 +1,177 @@
+#include "logger.h"
+
+#include <ctime>
+
+namespace logging {
+
+namespace {
+
+std::atomic<AsyncLogger*> current_logger{nullptr};
+
+void AppendEscaped(std::string& out, std::string_view value) {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    for (const char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += HEX_DIGITS[(c >> 4) & 0xF];
+                    out += HEX_DIGITS[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+}
+
+// Время в формате ISO 8601 с микросекундами, например 2024-01-31T12:00:00.123456Z
+void AppendTimestamp(std::string& out, std::chrono::system_clock::time_point timestamp) {
+    using namespace std::chrono;
+    const auto us = duration_cast<microseconds>(timestamp.time_since_epoch()).count();
+    const std::time_t seconds = static_cast<std::time_t>(us / 1'000'000);
+    // std::gmtime не потокобезопасна, но вызывается только из фонового потока журнала
+    const std::tm* tm = std::gmtime(&seconds);
+    char buffer[40];
+    const std::size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", tm);
+    out.append(buffer, length);
+    std::snprintf(buffer, sizeof(buffer), ".%06lldZ", static_cast<long long>(us % 1'000'000));
+    out += buffer;
+}
+
+void AppendRecord(std::string& out, const LogRecord& record) {
+    out += "{\"timestamp\":\"";
+    AppendTimestamp(out, record.timestamp);
+    if (record.kind == LogRecord::Kind::kRequest) {
+        out += "\",\"event\":\"request\",\"method\":\"";
+        AppendEscaped(out, record.label);
+        out += "\",\"target\":\"";
+        AppendEscaped(out, record.text.View());
+        out += "\",\"status\":";
+        out += std::to_string(record.status);
+        out += ",\"bytes_in\":";
+        out += std::to_string(record.bytes_in);
+        out += ",\"bytes_out\":";
+        out += std::to_string(record.bytes_out);
+        out += ",\"duration_us\":";
+        out += std::to_string(record.duration.count());
+        out += "}\n";
+    } else {
+        out += "\",\"event\":\"error\",\"where\":\"";
+        AppendEscaped(out, record.label);
+        out += "\",\"message\":\"";
+        AppendEscaped(out, record.text.View());
+        out += "\"}\n";
+    }
+}
+
+}  // namespace
+
+AsyncLogger::AsyncLogger(std::FILE* out)
+    : out_(out)
+    , worker_([this] {
+        Run();
+    }) {
+}
+
+AsyncLogger::~AsyncLogger() {
+    {
+        std::lock_guard lock{wakeup_mutex_};
+        stop_ = true;
+    }
+    wakeup_.notify_one();
+    worker_.join();
+}
+
+void AsyncLogger::Log(const LogRecord& record) noexcept {
+    Ring& ring = rings_.Get();
+    const std::size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) == RING_CAPACITY) {
+        ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    ring.records[head % RING_CAPACITY] = record;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+LoggerStats AsyncLogger::GetStats() const {
+    LoggerStats stats;
+    stats.written = written_.load(std::memory_order_relaxed);
+    rings_.ForEach([&stats](const Ring& ring) {
+        stats.dropped += ring.dropped.load(std::memory_order_relaxed);
+    });
+    return stats;
+}
+
+std::size_t AsyncLogger::Drain(std::string& buffer) {
+    drain_rings_.clear();
+    rings_.ForEach([this](Ring& ring) {
+        drain_rings_.push_back(&ring);
+    });
+    std::size_t count = 0;
+    for (Ring* ring : drain_rings_) {
+        const std::size_t head = ring->head.load(std::memory_order_acquire);
+        std::size_t tail = ring->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail, ++count) {
+            AppendRecord(buffer, ring->records[tail % RING_CAPACITY]);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    return count;
+}
+
+void AsyncLogger::Run() {
+    std::string buffer;
+    bool stopping = false;
+    while (!stopping) {
+        {
+            std::unique_lock lock{wakeup_mutex_};
+            wakeup_.wait_for(lock, FLUSH_INTERVAL, [this] {
+                return stop_;
+            });
+            stopping = stop_;
+        }
+        buffer.clear();
+        if (const std::size_t count = Drain(buffer); count > 0) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out_);
+            std::fflush(out_);
+            written_.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+}
+
+void AppendMetrics(std::string& out, const LoggerStats& stats) {
+    out += "# HELP log_records_written_total Log records written.\n"
+           "# TYPE log_records_written_total counter\n"
+           "log_records_written_total ";
+    out += std::to_string(stats.written);
+    out += "\n# HELP log_records_dropped_total Log records dropped on buffer overflow.\n"
+           "# TYPE log_records_dropped_total counter\n"
+           "log_records_dropped_total ";
+    out += std::to_string(stats.dropped);
+    out += '\n';
+}
+
+void SetLogger(AsyncLogger* logger) noexcept {
+    current_logger.store(logger, std::memory_order_release);
+}
+
+AsyncLogger* GetLogger() noexcept {
+    return current_logger.load(std::memory_order_acquire);
+}
+
+}  // namespace logging
@@ -0,0 +1,124 @@
+#pragma once
+#include "thread_slots.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+// Строка фиксированной ёмкости: запись журнала не должна выделять память в куче.
+// Не поместившийся хвост отбрасывается
+template <std::size_t Capacity>
+class FixedString {
+public:
+    void Assign(std::string_view value) noexcept {
+        size_ = std::min(value.size(), Capacity);
+        std::copy_n(value.data(), size_, data_.data());
+    }
+
+    std::string_view View() const noexcept {
+        return {data_.data(), size_};
+    }
+
+private:
+    std::array<char, Capacity> data_;
+    std::size_t size_ = 0;
+};
+
+// Запись журнала. Потоки-производители только заполняют её поля, а в JSON её
+// превращает фоновый поток
+struct LogRecord {
+    static constexpr std::size_t TEXT_CAPACITY = 192;
+
+    enum class Kind : std::uint8_t { kRequest, kError };
+
+    Kind kind = Kind::kRequest;
+    std::chrono::system_clock::time_point timestamp;
+    // Для kRequest - метод запроса, для kError - где произошла ошибка.
+    // Должна ссылаться на строку со статическим временем жизни
+    std::string_view label;
+    // Для kRequest - target запроса, для kError - описание ошибки
+    FixedString<TEXT_CAPACITY> text;
+    // Поля kRequest
+    unsigned status = 0;
+    std::uint64_t bytes_in = 0;
+    std::uint64_t bytes_out = 0;
+    std::chrono::microseconds duration{0};
+};
+
+struct LoggerStats {
+    std::uint64_t written = 0;
+    // Записи, отброшенные из-за переполнения буфера потока
+    std::uint64_t dropped = 0;
+};
+
+// Асинхронный журнал в формате JSON Lines. Каждый поток складывает записи в собственный
+// кольцевой буфер без блокировок, а фоновый поток пачками выводит их в файл.
+// Если буфер потока полон, запись отбрасывается и учитывается в счётчике dropped:
+// рабочий поток никогда не ждёт вывода
+class AsyncLogger {
+public:
+    // Записи в буфере одного потока
+    static constexpr std::size_t RING_CAPACITY = 1024;
+
+    // Не закрывает out
+    explicit AsyncLogger(std::FILE* out = stdout);
+    // Выводит оставшиеся записи и останавливает фоновый поток
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    void Log(const LogRecord& record) noexcept;
+
+    LoggerStats GetStats() const;
+
+private:
+    static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds{10};
+
+    // Кольцевой буфер с одним писателем (потоком-владельцем) и одним читателем (фоновым потоком)
+    struct Ring {
+        std::array<LogRecord, RING_CAPACITY> records;
+        alignas(64) std::atomic<std::size_t> head{0};  // пишет производитель
+        alignas(64) std::atomic<std::size_t> tail{0};  // пишет фоновый поток
+        std::atomic<std::uint64_t> dropped{0};
+    };
+
+    // Форматирует записи из всех буферов в buffer. Возвращает число записей
+    std::size_t Drain(std::string& buffer);
+    void Run();
+
+    std::FILE* out_;
+
+    util::ThreadSlots<Ring> rings_;
+    // Снимок rings_ для Drain. Используется только фоновым потоком и не выделяет память
+    // при каждом выводе
+    std::vector<Ring*> drain_rings_;
+
+    std::atomic<std::uint64_t> written_{0};
+    std::mutex wakeup_mutex_;
+    std::condition_variable wakeup_;
+    bool stop_ = false;
+    std::thread worker_;
+};
+
+// Добавляет счётчики журнала в out в текстовом формате Prometheus
+void AppendMetrics(std::string& out, const LoggerStats& stats);
+
+// Журнал, в который пишут сервер и обработчики. Если он не задан, ошибки выводятся
+// в std::cerr, а журнал запросов не ведётся
+void SetLogger(AsyncLogger* logger) noexcept;
+AsyncLogger* GetLogger() noexcept;
+
+}  // namespace logging
@@ -2,11 +2,25 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <thread>
+#include <vector>
 
 #include "json_loader.h"
+#include "logger.h"
 #include "request_handler.h"
+#include "tracing.h"
 #include "http_server.h"
 
 using namespace std::literals;
@@ -14,64 +28,271 @@ namespace net = boost::asio;
 
 namespace {
 
-// Запускает функцию fn на n потоках, включая текущий
-template <typename Fn>
-void RunWorkers(unsigned n, const Fn& fn) {
-    n = std::max(1u, n);
-    std::vector<std::jthread> workers;
-    workers.reserve(n - 1);
-    // Запускаем n-1 рабочих потоков, выполняющих функцию fn
-    while (--n) {
-        workers.emplace_back(fn);
+struct Args {
+    std::string config_file;
+    std::string static_root;
+    http_server::IoContextPool::Mode mode = http_server::IoContextPool::Mode::kShared;
+    bool pin_threads = false;
+    std::size_t static_cache_size = http_handler::StaticCache::DEFAULT_MAX_BYTES;
+    http_server::ConnectionLimits limits;
+    std::chrono::milliseconds drain_timeout = 10s;
+    // Файл журнала. Если не задан, журнал выводится в stdout
+    std::string log_file;
+    // Ограничения частоты запросов по номерам маршрутов RequestHandler::Route
+    std::vector<http_handler::RateLimit> rate_limits =
+        std::vector<http_handler::RateLimit>(http_handler::RequestHandler::ROUTE_NAMES.size());
+#ifdef GAME_SERVER_TRACING
+    // Файл, в который по сигналу SIGUSR1 записывается трасса
+    std::string trace_file = "game_server_trace.json";
+#endif
+};
+
+// Делает журнал текущим на время своей жизни. Снимает его раньше, чем журнал разрушится,
+// в том числе при выходе по исключению
+class LoggerRegistration {
+public:
+    explicit LoggerRegistration(logging::AsyncLogger& logger) noexcept {
+        logging::SetLogger(&logger);
+    }
+    ~LoggerRegistration() {
+        logging::SetLogger(nullptr);
+    }
+
+    LoggerRegistration(const LoggerRegistration&) = delete;
+    LoggerRegistration& operator=(const LoggerRegistration&) = delete;
+};
+
+// Разрушает таймеры ConnectionManager при выходе из области видимости. Объявляется после
+// пула io_context, чтобы сработать, когда потоки пула завершились, а io_context ещё живы
+class ConnectionManagerShutdown {
+public:
+    explicit ConnectionManagerShutdown(http_server::ConnectionManager& connections) noexcept
+        : connections_(connections) {
+    }
+    ~ConnectionManagerShutdown() {
+        connections_.Shutdown();
+    }
+
+    ConnectionManagerShutdown(const ConnectionManagerShutdown&) = delete;
+    ConnectionManagerShutdown& operator=(const ConnectionManagerShutdown&) = delete;
+
+private:
+    http_server::ConnectionManager& connections_;
+};
+
+// Разбирает неотрицательное целое число и умножает его на scale.
+// Возвращает std::nullopt, если value не число целиком или произведение не помещается в T
+template <typename T>
+std::optional<T> ParseUnsigned(std::string_view value, T scale = 1) {
+    T number{};
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), number);
+    if (ec != std::errc{} || end != value.data() + value.size() || number > std::numeric_limits<T>::max() / scale) {
+        return std::nullopt;
     }
-    fn();
+    return number * scale;
+}
+
+// Разбирает ограничение вида <маршрут>=<запросов в секунду>[/<всплеск>], например static=50/100.
+// Если всплеск не указан, он равен частоте, но не меньше одного запроса. При ошибке возвращает false
+bool ParseRateLimit(std::string_view value, std::vector<http_handler::RateLimit>& limits) {
+    const auto& names = http_handler::RequestHandler::ROUTE_NAMES;
+    const auto eq_pos = value.find('=');
+    if (eq_pos == std::string_view::npos) {
+        return false;
+    }
+    const auto name = std::find(names.begin(), names.end(), value.substr(0, eq_pos));
+    if (name == names.end()) {
+        return false;
+    }
+    const std::string numbers{value.substr(eq_pos + 1)};
+    char* end = nullptr;
+    http_handler::RateLimit limit;
+    limit.rate = std::strtod(numbers.c_str(), &end);
+    limit.burst = std::max(limit.rate, 1.0);
+    if (*end == '/') {
+        limit.burst = std::strtod(end + 1, &end);
+    }
+    // strtod принимает nan и inf, такие значения ограничением не считаются
+    if (end == numbers.c_str() || *end != '\0' || !std::isfinite(limit.rate) || !std::isfinite(limit.burst)
+        || limit.rate < 0 || limit.burst < 1) {
+        return false;
+    }
+    limits[name - names.begin()] = limit;
+    return true;
+}
+
+// Разбирает аргументы командной строки. При ошибке возвращает std::nullopt
+std::optional<Args> ParseCommandLine(int argc, const char* argv[]) {
+    if (argc < 3) {
+        return std::nullopt;
+    }
+    Args args;
+    args.config_file = argv[1];
+    args.static_root = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        const std::string_view option = argv[i];
+        if (option == "--per-core"sv) {
+            args.mode = http_server::IoContextPool::Mode::kPerCore;
+        } else if (option == "--pin-threads"sv) {
+            args.pin_threads = true;
+        } else if (option == "--static-cache-mb"sv && i + 1 < argc) {
+            const auto size = ParseUnsigned<std::size_t>(argv[++i], 1024 * 1024);
+            if (!size) {
+                return std::nullopt;
+            }
+            args.static_cache_size = *size;
+        } else if (option == "--max-sessions"sv && i + 1 < argc) {
+            const auto sessions = ParseUnsigned<std::size_t>(argv[++i]);
+            if (!sessions) {
+                return std::nullopt;
+            }
+            args.limits.max_sessions = *sessions;
+        } else if (option == "--max-sessions-per-ip"sv && i + 1 < argc) {
+            const auto sessions = ParseUnsigned<std::size_t>(argv[++i]);
+            if (!sessions) {
+                return std::nullopt;
+            }
+            args.limits.max_sessions_per_address = *sessions;
+        } else if (option == "--max-buffered-mb"sv && i + 1 < argc) {
+            const auto size = ParseUnsigned<std::size_t>(argv[++i], 1024 * 1024);
+            if (!size) {
+                return std::nullopt;
+            }
+            args.limits.max_buffered_bytes = *size;
+        } else if (option == "--max-loop-lag-ms"sv && i + 1 < argc) {
+            const auto lag = ParseUnsigned<std::uint32_t>(argv[++i]);
+            if (!lag) {
+                return std::nullopt;
+            }
+            args.limits.max_loop_lag = std::chrono::milliseconds{*lag};
+        } else if (option == "--log-file"sv && i + 1 < argc) {
+            args.log_file = argv[++i];
+        } else if (option == "--rate-limit"sv && i + 1 < argc) {
+            if (!ParseRateLimit(argv[++i], args.rate_limits)) {
+                return std::nullopt;
+            }
+        } else if (option == "--drain-timeout-ms"sv && i + 1 < argc) {
+            const auto timeout = ParseUnsigned<std::uint32_t>(argv[++i]);
+            if (!timeout) {
+                return std::nullopt;
+            }
+            args.drain_timeout = std::chrono::milliseconds{*timeout};
+#ifdef GAME_SERVER_TRACING
+        } else if (option == "--trace-file"sv && i + 1 < argc) {
+            args.trace_file = argv[++i];
+#endif
+        } else {
+            return std::nullopt;
+        }
+    }
+    return args;
 }
 
 }  // namespace
 
 int main(int argc, const char* argv[]) {
-    // Исправьте проверку на 3 аргумента и сообщение об использовании
-    if (argc != 3) {
-        std::cerr << "Usage: game_server <game-config-json> <static-files-path>"sv << std::endl;
+    const auto args = ParseCommandLine(argc, argv);
+    if (!args) {
+        std::cerr << "Usage: game_server <game-config-json> <static-files-path> "
+                     "[--per-core] [--pin-threads] [--static-cache-mb <size>] "
+                     "[--max-sessions <n>] [--max-sessions-per-ip <n>] [--max-buffered-mb <size>] "
+                     "[--max-loop-lag-ms <ms>] [--drain-timeout-ms <ms>] [--log-file <path>] "
+                     "[--rate-limit <route>=<rps>[/<burst>]]..."
+#ifdef GAME_SERVER_TRACING
+                     " [--trace-file <path>]"
+#endif
+                  << std::endl;
         return EXIT_FAILURE;
     }
     try {
         // 1. Загружаем карту из файла и построить модель игры
-        model::Game game = json_loader::LoadGame(argv[1]);
-
-        // 2. Инициализируем io_context
-        const unsigned num_threads = std::thread::hardware_concurrency();
-        net::io_context ioc(num_threads);
-
-        // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
-        net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const boost::system::error_code& ec, int signal_number) {
-            if (!ec) {
-                std::cout << "Signal " << signal_number << " received, stopping..." << std::endl;
-                ioc.stop();
+        model::Game game = json_loader::LoadGame(args->config_file);
+
+        // Журнал создаётся раньше пула потоков, чтобы пережить все рабочие потоки
+        std::unique_ptr<std::FILE, decltype(&std::fclose)> log_file{nullptr, &std::fclose};
+        if (!args->log_file.empty()) {
+            log_file.reset(std::fopen(args->log_file.c_str(), "a"));
+            if (!log_file) {
+                throw std::runtime_error("Failed to open log file " + args->log_file);
             }
+        }
+        logging::AsyncLogger logger{log_file ? log_file.get() : stdout};
+        const LoggerRegistration logger_registration{logger};
+
+        // 2. Инициализируем пул io_context: общий для всех потоков или по одному на поток
+        const unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+        http_server::IoContextPool pool(args->mode, num_threads, args->pin_threads);
+
+        // 3. Создаём общий для всех акцепторов контроль соединений и метрики сервера
+        auto connections = std::make_shared<http_server::ConnectionManager>(args->limits);
+        const ConnectionManagerShutdown connections_shutdown{*connections};
+        auto metrics = std::make_shared<http_server::Metrics>(std::vector<std::string>(
+            http_handler::RequestHandler::ROUTE_NAMES.begin(), http_handler::RequestHandler::ROUTE_NAMES.end()));
+        metrics->AddCollector([connections, &logger](std::string& out) {
+            http_server::AppendMetrics(out, connections->GetStats());
+            logging::AppendMetrics(out, logger.GetStats());
+        });
+
+        // 4. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM.
+        // Первый сигнал запускает плавную остановку, повторный останавливает сервер немедленно
+        net::signal_set signals(pool.GetContext(0), SIGINT, SIGTERM);
+        signals.async_wait([&](const boost::system::error_code& ec, int signal_number) {
+            if (ec) {
+                return;
+            }
+            std::cout << "Signal " << signal_number << " received, draining..." << std::endl;
+            connections->Drain(pool.GetContext(0), args->drain_timeout, [&pool] {
+                // Здесь же будут сохраняться несохранённые данные перед остановкой
+                std::cout << "Drained, stopping..." << std::endl;
+                pool.Stop();
+            });
+            signals.async_wait([&pool](const boost::system::error_code& ec, int signal_number) {
+                if (!ec) {
+                    std::cout << "Signal " << signal_number << " received, stopping..." << std::endl;
+                    pool.Stop();
+                }
+            });
         });
 
-        // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
-        http_handler::RequestHandler handler{game, argv[2]};
+#ifdef GAME_SERVER_TRACING
+        // По сигналу SIGUSR1 последние события трассы всех потоков записываются в файл
+        net::signal_set trace_signals(pool.GetContext(0), SIGUSR1);
+        std::function<void()> wait_trace_signal = [&] {
+            trace_signals.async_wait([&](const boost::system::error_code& ec, int) {
+                if (ec) {
+                    return;
+                }
+                try {
+                    const std::size_t count = tracing::WriteChromeTrace(args->trace_file);
+                    std::cout << "Trace of " << count << " events written to " << args->trace_file << std::endl;
+                } catch (const std::exception& ex) {
+                    std::cerr << ex.what() << std::endl;
+                }
+                wait_trace_signal();
+            });
+        };
+        wait_trace_signal();
+#endif
 
-        // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
+        // 5. Создаём обработчик HTTP-запросов и связываем его с моделью игры
+        http_handler::RequestHandler handler{game, *metrics, args->static_root, args->static_cache_size,
+                                              args->rate_limits};
+
+        // 6. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         const auto address = net::ip::make_address("0.0.0.0");
         constexpr unsigned short port = 8080;
         
-        http_server::ServeHttp(ioc, {address, port}, [&handler](auto&& req, auto&& send) {
+        http_server::ServeHttp(pool, {address, port}, [&handler](auto&& req, auto&& send) {
             handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
-        });
+        }, connections, metrics);
 
         // Эта надпись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы
         std::cout << "Server has started..." << std::endl;
 
-        // 6. Запускаем обработку асинхронных операций
-        RunWorkers(std::max(1u, num_threads), [&ioc] {
-            ioc.run();
-        });
+        // 7. Запускаем обработку асинхронных операций
+        pool.Run();
     } catch (const std::exception& ex) {
         std::cerr << ex.what() << std::endl;
         return EXIT_FAILURE;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,168 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+
+namespace http_server {
+
+namespace {
+
+// Счётчики меняет только поток-владелец, поэтому достаточно обычных load и store
+// без дорогой атомарной операции fetch_add
+void Add(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+std::uint64_t Load(const std::atomic<std::uint64_t>& counter) noexcept {
+    return counter.load(std::memory_order_relaxed);
+}
+
+constexpr std::string_view PHASE_NAMES[] = {"accept_to_first_byte", "handler", "write", "request"};
+
+// Микросекунды в виде секунд для меток и сумм Prometheus
+std::string FormatSeconds(std::uint64_t us) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%llu.%06llu", static_cast<unsigned long long>(us / 1'000'000),
+                  static_cast<unsigned long long>(us % 1'000'000));
+    return buffer;
+}
+
+void AppendSample(std::string& out, std::string_view name, std::string_view labels, std::string_view value) {
+    out.append(name);
+    out += '{';
+    out.append(labels);
+    out += "} ";
+    out.append(value);
+    out += '\n';
+}
+
+}  // namespace
+
+Metrics::Metrics(std::vector<std::string> route_names)
+    : route_names_(std::move(route_names)) {
+    route_names_.resize(MAX_ROUTES);
+    for (std::size_t i = 0; i < MAX_ROUTES; ++i) {
+        if (route_names_[i].empty()) {
+            route_names_[i] = std::to_string(i);
+        }
+    }
+}
+
+void Metrics::RecordDuration(RouteId route, Phase phase, std::chrono::steady_clock::duration duration) noexcept {
+    const auto us = static_cast<std::uint64_t>(
+        std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+    // Наименьшее i, при котором us <= 2^i
+    const std::size_t bucket = std::min<std::size_t>(us <= 1 ? 0 : std::bit_width(us - 1), BUCKET_COUNT - 1);
+    Histogram& histogram = threads_.Get().routes[route % MAX_ROUTES].phases[static_cast<std::size_t>(phase)];
+    Add(histogram.buckets[bucket], 1);
+    Add(histogram.sum_us, us);
+}
+
+void Metrics::RecordResponse(RouteId route, unsigned status, std::size_t bytes_in, std::size_t bytes_out) noexcept {
+    RouteMetrics& metrics = threads_.Get().routes[route % MAX_ROUTES];
+    const unsigned status_class = std::clamp(status / 100, 1u, 5u);
+    Add(metrics.responses[status_class - 1], 1);
+    Add(metrics.bytes_in, bytes_in);
+    Add(metrics.bytes_out, bytes_out);
+}
+
+void Metrics::AddCollector(Collector collector) {
+    collectors_.push_back(std::move(collector));
+}
+
+std::string Metrics::Render() const {
+    // Суммируем блоки всех потоков. Значения читаются без остановки потоков,
+    // поэтому снимок может быть неточен в пределах нескольких запросов
+    struct HistogramSnapshot {
+        std::array<std::uint64_t, BUCKET_COUNT> buckets{};
+        std::uint64_t sum_us = 0;
+    };
+    struct RouteSnapshot {
+        std::array<HistogramSnapshot, PHASE_COUNT> phases;
+        std::array<std::uint64_t, 5> responses{};
+        std::uint64_t bytes_in = 0;
+        std::uint64_t bytes_out = 0;
+    };
+    std::array<RouteSnapshot, MAX_ROUTES> routes;
+    threads_.ForEach([&routes](const ThreadMetrics& thread_metrics) {
+        for (std::size_t r = 0; r < MAX_ROUTES; ++r) {
+            const RouteMetrics& src = thread_metrics.routes[r];
+            RouteSnapshot& dst = routes[r];
+            for (std::size_t p = 0; p < PHASE_COUNT; ++p) {
+                for (std::size_t b = 0; b < BUCKET_COUNT; ++b) {
+                    dst.phases[p].buckets[b] += Load(src.phases[p].buckets[b]);
+                }
+                dst.phases[p].sum_us += Load(src.phases[p].sum_us);
+            }
+            for (std::size_t c = 0; c < dst.responses.size(); ++c) {
+                dst.responses[c] += Load(src.responses[c]);
+            }
+            dst.bytes_in += Load(src.bytes_in);
+            dst.bytes_out += Load(src.bytes_out);
+        }
+    });
+
+    std::string out;
+    out += "# HELP http_request_duration_seconds Duration of request processing phases.\n"
+           "# TYPE http_request_duration_seconds histogram\n";
+    for (std::size_t r = 0; r < MAX_ROUTES; ++r) {
+        for (std::size_t p = 0; p < PHASE_COUNT; ++p) {
+            const HistogramSnapshot& histogram = routes[r].phases[p];
+            const std::string labels = "route=\"" + route_names_[r] + "\",phase=\"" + std::string(PHASE_NAMES[p]) + '"';
+            std::uint64_t count = 0;
+            for (std::uint64_t bucket : histogram.buckets) {
+                count += bucket;
+            }
+            if (count == 0) {
+                continue;
+            }
+            std::uint64_t cumulative = 0;
+            for (std::size_t b = 0; b < BUCKET_COUNT; ++b) {
+                cumulative += histogram.buckets[b];
+                const std::string le = b + 1 < BUCKET_COUNT ? FormatSeconds(std::uint64_t{1} << b) : "+Inf";
+                AppendSample(out, "http_request_duration_seconds_bucket", labels + ",le=\"" + le + '"',
+                             std::to_string(cumulative));
+            }
+            AppendSample(out, "http_request_duration_seconds_sum", labels, FormatSeconds(histogram.sum_us));
+            AppendSample(out, "http_request_duration_seconds_count", labels, std::to_string(count));
+        }
+    }
+
+    out += "# HELP http_responses_total Responses sent, by status class.\n"
+           "# TYPE http_responses_total counter\n";
+    for (std::size_t r = 0; r < MAX_ROUTES; ++r) {
+        for (std::size_t c = 0; c < routes[r].responses.size(); ++c) {
+            if (routes[r].responses[c] != 0) {
+                AppendSample(out, "http_responses_total",
+                             "route=\"" + route_names_[r] + "\",code=\"" + std::to_string(c + 1) + "xx\"",
+                             std::to_string(routes[r].responses[c]));
+            }
+        }
+    }
+
+    out += "# HELP http_request_bytes_total Bytes of requests received.\n"
+           "# TYPE http_request_bytes_total counter\n";
+    for (std::size_t r = 0; r < MAX_ROUTES; ++r) {
+        if (routes[r].bytes_in != 0) {
+            AppendSample(out, "http_request_bytes_total", "route=\"" + route_names_[r] + '"',
+                         std::to_string(routes[r].bytes_in));
+        }
+    }
+
+    out += "# HELP http_response_bytes_total Bytes of responses sent.\n"
+           "# TYPE http_response_bytes_total counter\n";
+    for (std::size_t r = 0; r < MAX_ROUTES; ++r) {
+        if (routes[r].bytes_out != 0) {
+            AppendSample(out, "http_response_bytes_total", "route=\"" + route_names_[r] + '"',
+                         std::to_string(routes[r].bytes_out));
+        }
+    }
+
+    for (const Collector& collector : collectors_) {
+        collector(out);
+    }
+    return out;
+}
+
+}  // namespace http_server
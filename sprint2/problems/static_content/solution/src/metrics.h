@@ -0,0 +1,104 @@
+#pragma once
+#include "thread_slots.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http_server {
+
+// Номер маршрута, к которому относится запрос. Имена маршрутов задаёт обработчик запросов
+using RouteId = std::uint8_t;
+
+// Маршрут запросов, для которых обработчик не указал маршрут
+inline constexpr RouteId UNKNOWN_ROUTE = 0;
+
+namespace detail {
+// Маршрут запроса, обрабатываемого в текущем потоке
+inline thread_local RouteId current_route = UNKNOWN_ROUTE;
+}  // namespace detail
+
+// Обработчик запроса сообщает, к какому маршруту относится запрос.
+// Вызывается из обработчика, пока SessionBase выполняет HandleRequest
+inline void SetRequestRoute(RouteId route) noexcept {
+    detail::current_route = route;
+}
+
+inline RouteId GetRequestRoute() noexcept {
+    return detail::current_route;
+}
+
+// Метрики HTTP-сервера: задержки, объём трафика и коды ответов по маршрутам.
+// Каждый рабочий поток пишет только в свой блок счётчиков, поэтому запись не требует
+// блокировок и атомарных read-modify-write операций. При чтении блоки всех потоков суммируются
+class Metrics {
+public:
+    static constexpr std::size_t MAX_ROUTES = 16;
+
+    // Этапы обработки запроса, длительность которых измеряется
+    enum class Phase {
+        // От принятия соединения до начала отправки первого ответа в нём
+        kAcceptToFirstByte,
+        // Выполнение обработчика запроса
+        kHandler,
+        // Отправка ответа
+        kWrite,
+        // От получения запроса до завершения отправки ответа
+        kRequest,
+    };
+    static constexpr std::size_t PHASE_COUNT = 4;
+
+    // Дополнительный источник метрик, добавляющий строки в ответ /metrics
+    using Collector = std::function<void(std::string& out)>;
+
+    // route_names[0] - имя маршрута UNKNOWN_ROUTE
+    explicit Metrics(std::vector<std::string> route_names = {});
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void RecordDuration(RouteId route, Phase phase, std::chrono::steady_clock::duration duration) noexcept;
+    void RecordResponse(RouteId route, unsigned status, std::size_t bytes_in, std::size_t bytes_out) noexcept;
+
+    // Регистрирует источник дополнительных метрик. Вызывается до запуска сервера
+    void AddCollector(Collector collector);
+
+    // Возвращает все метрики в текстовом формате Prometheus
+    std::string Render() const;
+
+private:
+    // Гистограмма с корзинами по степеням двойки микросекунд:
+    // корзина i содержит значения до 2^i мкс, последняя - все остальные
+    static constexpr std::size_t BUCKET_COUNT = 27;
+
+    struct Histogram {
+        std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> buckets{};
+        std::atomic<std::uint64_t> sum_us{0};
+    };
+
+    struct RouteMetrics {
+        std::array<Histogram, PHASE_COUNT> phases;
+        // Ответы по классам кодов: 1xx ... 5xx
+        std::array<std::atomic<std::uint64_t>, 5> responses{};
+        std::atomic<std::uint64_t> bytes_in{0};
+        std::atomic<std::uint64_t> bytes_out{0};
+    };
+
+    // Счётчики одного рабочего потока. Пишет в них только этот поток
+    struct ThreadMetrics {
+        std::array<RouteMetrics, MAX_ROUTES> routes;
+    };
+
+    std::vector<std::string> route_names_;
+    std::vector<Collector> collectors_;
+
+    util::ThreadSlots<ThreadMetrics> threads_;
+};
+
+}  // namespace http_server
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -27,6 +28,13 @@ struct Offset {
     Dimension dx, dy;
 };
 
+// Неизменяемое сериализованное представление объекта модели вместе с его ETag.
+// Буфер разделяется между всеми ответами, которые его отправляют
+struct Serialized {
+    std::shared_ptr<const std::string> data;
+    std::string etag;
+};
+
 class Road {
     struct HorizontalTag {
         explicit HorizontalTag() = default;
@@ -155,6 +163,23 @@ public:
 
     void AddOffice(Office office);
 
+    const Serialized& GetSerialized() const noexcept {
+        return serialized_;
+    }
+
+    void SetSerialized(Serialized serialized) {
+        serialized_ = std::move(serialized);
+    }
+
+    // Двоичное представление карты (binary_encoding.h)
+    const Serialized& GetSerializedBinary() const noexcept {
+        return serialized_binary_;
+    }
+
+    void SetSerializedBinary(Serialized serialized) {
+        serialized_binary_ = std::move(serialized);
+    }
+
 private:
     using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
 
@@ -165,6 +190,9 @@ private:
 
     OfficeIdToIndex warehouse_id_to_index_;
     Offices offices_;
+
+    Serialized serialized_;
+    Serialized serialized_binary_;
 };
 
 class Game {
@@ -184,12 +212,22 @@ public:
         return nullptr;
     }
 
+    // Список карт (идентификаторы и названия) в готовом для API виде
+    const Serialized& GetSerializedMaps() const noexcept {
+        return serialized_maps_;
+    }
+
+    void SetSerializedMaps(Serialized serialized) {
+        serialized_maps_ = std::move(serialized);
+    }
+
 private:
     using MapIdHasher = util::TaggedHasher<Map::Id>;
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
 
     std::vector<Map> maps_;
     MapIdToIndex map_id_to_index_;
+    Serialized serialized_maps_;
 };
 
 }  // namespace model
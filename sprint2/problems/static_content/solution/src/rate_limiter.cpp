@@ -0,0 +1,65 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace http_handler {
+
+namespace {
+
+// Предел интервалов в наносекундах, при котором их сумма с текущим временем не переполняется
+constexpr double MAX_INTERVAL_NS = static_cast<double>(std::numeric_limits<std::int64_t>::max() / 4);
+
+}  // namespace
+
+RateLimiter::RateLimiter(const std::vector<RateLimit>& limits)
+    : routes_(limits.size()) {
+    for (std::size_t i = 0; i < limits.size(); ++i) {
+        const RateLimit& limit = limits[i];
+        if (limit.rate <= 0) {
+            continue;
+        }
+        RouteBuckets& route = routes_[i];
+        route.interval_ns = std::max<std::int64_t>(1, std::llround(std::min(1e9 / limit.rate, MAX_INTERVAL_NS)));
+        route.tolerance_ns = static_cast<std::int64_t>(
+            std::min(route.interval_ns * (std::max(limit.burst, 1.0) - 1), MAX_INTERVAL_NS));
+        route.buckets = std::make_unique<std::atomic<std::int64_t>[]>(BUCKETS_PER_ROUTE);
+    }
+}
+
+RateLimiter::Decision RateLimiter::TryAcquire(std::size_t route, std::uint64_t key,
+                                              Clock::time_point now) noexcept {
+    if (!IsLimited(route)) {
+        return {};
+    }
+    const RouteBuckets& buckets = routes_[route];
+    // Перемешиваем биты, чтобы близкие ключи не попадали в соседние корзины
+    auto& bucket = buckets.buckets[((key * 0x9E3779B97F4A7C15ull) >> 48) % BUCKETS_PER_ROUTE];
+
+    const std::int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    std::int64_t full_at = bucket.load(std::memory_order_relaxed);
+    for (;;) {
+        // Корзина, наполнившаяся в прошлом, полна и сейчас
+        const std::int64_t base = std::max(full_at, now_ns);
+        if (base - now_ns > buckets.tolerance_ns) {
+            return {false, std::chrono::nanoseconds{base - buckets.tolerance_ns - now_ns}};
+        }
+        if (bucket.compare_exchange_weak(full_at, base + buckets.interval_ns, std::memory_order_relaxed)) {
+            return {};
+        }
+    }
+}
+
+std::uint64_t RateLimiter::HashAddress(const boost::asio::ip::address& address) noexcept {
+    if (address.is_v4()) {
+        return address.to_v4().to_uint();
+    }
+    std::uint64_t hash = 0;
+    for (const unsigned char byte : address.to_v6().to_bytes()) {
+        hash = hash * 31 + byte;
+    }
+    return hash;
+}
+
+}  // namespace http_handler
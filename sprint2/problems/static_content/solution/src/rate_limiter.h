@@ -0,0 +1,63 @@
+#pragma once
+#include <boost/asio/ip/address.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace http_handler {
+
+// Ограничение частоты запросов одного клиента к одному маршруту
+struct RateLimit {
+    // Сколько запросов в секунду клиент может делать в среднем. 0 - без ограничения
+    double rate = 0;
+    // Сколько запросов подряд клиент может сделать после простоя
+    double burst = 1;
+};
+
+// Ограничивает частоту запросов по алгоритму token bucket.
+// Для каждого маршрута с ограничением заводится таблица корзин, адрес клиента
+// хешируется в одну из них. Корзина хранит не число токенов, а момент, когда она снова
+// наполнится (GCRA): одного атомарного 64-битного значения достаточно, и проверка сводится
+// к циклу compare_exchange без блокировок. Клиенты, попавшие в одну корзину, делят её лимит
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Корзин в таблице одного маршрута
+    static constexpr std::size_t BUCKETS_PER_ROUTE = 65'536;
+
+    struct Decision {
+        bool allowed = true;
+        // Через сколько можно повторить отклонённый запрос
+        Clock::duration retry_after{};
+    };
+
+    // limits[i] - ограничение маршрута с номером i. Маршруты без ограничения памяти не занимают
+    explicit RateLimiter(const std::vector<RateLimit>& limits = {});
+
+    // Расходует токен из корзины клиента key маршрута route
+    Decision TryAcquire(std::size_t route, std::uint64_t key, Clock::time_point now = Clock::now()) noexcept;
+
+    bool IsLimited(std::size_t route) const noexcept {
+        return route < routes_.size() && routes_[route].buckets;
+    }
+
+    static std::uint64_t HashAddress(const boost::asio::ip::address& address) noexcept;
+
+private:
+    struct RouteBuckets {
+        // Интервал между запросами при средней частоте
+        std::int64_t interval_ns = 0;
+        // Насколько момент наполнения корзины может опережать текущее время
+        std::int64_t tolerance_ns = 0;
+        // Момент наполнения корзины, нс от эпохи Clock
+        std::unique_ptr<std::atomic<std::int64_t>[]> buckets;
+    };
+
+    std::vector<RouteBuckets> routes_;
+};
+
+}  // namespace http_handler
@@ -0,0 +1,142 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace http_server {
+
+namespace detail {
+
+// Кэш освобождённых блоков памяти текущего потока, разбитых на классы по размеру
+class RecyclingCache {
+public:
+    static constexpr std::size_t GRANULARITY = 64;
+    static constexpr std::size_t MAX_CACHED_SIZE = 2048;
+    // Сколько свободных блоков одного класса может храниться в кэше
+    static constexpr std::size_t MAX_BLOCKS_PER_CLASS = 256;
+
+    RecyclingCache() = default;
+    RecyclingCache(const RecyclingCache&) = delete;
+    RecyclingCache& operator=(const RecyclingCache&) = delete;
+
+    ~RecyclingCache() {
+        for (FreeBlock* head : heads_) {
+            while (head) {
+                ::operator delete(std::exchange(head, head->next));
+            }
+        }
+    }
+
+    static RecyclingCache& ForCurrentThread() {
+        thread_local RecyclingCache cache;
+        return cache;
+    }
+
+    void* Allocate(std::size_t size, std::size_t alignment) {
+        if (!IsCacheable(size, alignment)) {
+            return ::operator new(size, std::align_val_t{alignment});
+        }
+        const std::size_t size_class = SizeClass(size);
+        if (FreeBlock* block = heads_[size_class]) {
+            heads_[size_class] = block->next;
+            --counts_[size_class];
+            return block;
+        }
+        return ::operator new((size_class + 1) * GRANULARITY);
+    }
+
+    void Deallocate(void* pointer, std::size_t size, std::size_t alignment) noexcept {
+        if (!IsCacheable(size, alignment)) {
+            return ::operator delete(pointer, std::align_val_t{alignment});
+        }
+        const std::size_t size_class = SizeClass(size);
+        if (counts_[size_class] == MAX_BLOCKS_PER_CLASS) {
+            return ::operator delete(pointer);
+        }
+        heads_[size_class] = new (pointer) FreeBlock{heads_[size_class]};
+        ++counts_[size_class];
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static constexpr std::size_t CLASS_COUNT = MAX_CACHED_SIZE / GRANULARITY;
+
+    static bool IsCacheable(std::size_t size, std::size_t alignment) noexcept {
+        return size != 0 && size <= MAX_CACHED_SIZE && alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    }
+
+    static std::size_t SizeClass(std::size_t size) noexcept {
+        return (size - 1) / GRANULARITY;
+    }
+
+    std::array<FreeBlock*, CLASS_COUNT> heads_{};
+    std::array<std::size_t, CLASS_COUNT> counts_{};
+};
+
+}  // namespace detail
+
+// Аллокатор, который не возвращает освобождённые блоки в кучу, а кэширует их в текущем потоке.
+// Подходит для объектов, которые создаются и удаляются на каждое соединение или запрос:
+// блоков управления shared_ptr, состояний асинхронных операций.
+// Блок, освобождённый в другом потоке, попадает в кэш того потока
+template <typename T>
+class RecyclingAllocator {
+public:
+    using value_type = T;
+
+    RecyclingAllocator() noexcept = default;
+
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {
+    }
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(detail::RecyclingCache::ForCurrentThread().Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, std::size_t n) noexcept {
+        detail::RecyclingCache::ForCurrentThread().Deallocate(pointer, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const RecyclingAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+// Обработчик завершения асинхронной операции, связанный с RecyclingAllocator.
+// Asio и Beast находят аллокатор через associated_allocator и размещают в нём состояние
+// операции, поэтому в установившемся режиме операции не выделяют память в куче
+template <typename Handler>
+class RecyclingHandler {
+public:
+    using allocator_type = RecyclingAllocator<void>;
+
+    explicit RecyclingHandler(Handler handler)
+        : handler_(std::move(handler)) {
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return {};
+    }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    Handler handler_;
+};
+
+template <typename Handler>
+RecyclingHandler<std::decay_t<Handler>> BindRecyclingAllocator(Handler&& handler) {
+    return RecyclingHandler<std::decay_t<Handler>>{std::forward<Handler>(handler)};
+}
+
+}  // namespace http_server
@@ -0,0 +1,21 @@
+#pragma once
+#include <boost/asio/ip/address.hpp>
+
+namespace http_server {
+
+namespace detail {
+// Адрес клиента, запрос которого обрабатывается в текущем потоке
+inline thread_local boost::asio::ip::address current_remote_address;
+}  // namespace detail
+
+// Сессия сообщает адрес клиента перед вызовом обработчика запроса
+inline void SetRequestRemoteAddress(const boost::asio::ip::address& address) noexcept {
+    detail::current_remote_address = address;
+}
+
+// Адрес клиента текущего запроса. Вызывается из обработчика, пока сессия выполняет HandleRequest
+inline const boost::asio::ip::address& GetRequestRemoteAddress() noexcept {
+    return detail::current_remote_address;
+}
+
+}  // namespace http_server
@@ -1,16 +1,27 @@
 #pragma once
+#include "sdk.h"
+#include "binary_encoding.h"
 #include "model.h"
+#include "etag.h"
+#include "metrics.h"
+#include "rate_limiter.h"
+#include "request_context.h"
+#include "router.h"
+#include "shared_body.h"
+#include "static_cache.h"
+#include "tracing.h"
 #include <boost/beast.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
+#include <chrono>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <filesystem>
-#include <fstream>
 #include <unordered_map>
 #include <iostream>
-#include <sstream>
-#include <algorithm> 
+#include <algorithm>
+#include <array>
 
 namespace http_handler {
 namespace beast = boost::beast;
@@ -27,30 +38,77 @@ public:
     static constexpr string_view PLAYERS_LIST_ENDPOINT = "/api/v1/game/players";
     static constexpr string_view GAME_STATE_ENDPOINT = "/api/v1/game/state";
     static constexpr string_view API_PREFIX = "/api/";
-
-    explicit RequestHandler(model::Game& game, const std::string& static_path = "") 
-        : game_(game), static_path_(static_path) {
+    static constexpr string_view METRICS_ENDPOINT = "/metrics";
+
+    // Маршруты, по которым собираются метрики сервера
+    enum class Route : http_server::RouteId {
+        kOther = http_server::UNKNOWN_ROUTE,
+        kMapsList,
+        kMap,
+        kJoinGame,
+        kStatic,
+        kMetrics,
+    };
+    static constexpr std::array<string_view, 6> ROUTE_NAMES = {
+        "other", "maps_list", "map", "join_game", "static", "metrics",
+    };
+
+    enum class Endpoint { kMapsList, kMapById, kJoinGame };
+    using ApiRouter = Router<Endpoint, 3>;
+
+    static constexpr ApiRouter ROUTER{{{
+        {MAPS_LIST_ENDPOINT, ApiRouter::MatchKind::kExact, http::verb::get, Endpoint::kMapsList},
+        {MAP_BY_ID_ENDPOINT_PREFIX, ApiRouter::MatchKind::kPrefix, http::verb::get, Endpoint::kMapById},
+        {JOIN_GAME_ENDPOINT, ApiRouter::MatchKind::kExact, http::verb::post, Endpoint::kJoinGame},
+    }}};
+
+    RequestHandler(model::Game& game, const http_server::Metrics& metrics, const std::string& static_path = "",
+                   std::size_t static_cache_size = StaticCache::DEFAULT_MAX_BYTES,
+                   const std::vector<RateLimit>& rate_limits = {})
+        : game_(game), metrics_(metrics), static_path_(static_path), static_cache_(static_path, static_cache_size)
+        , rate_limiter_(rate_limits) {
         InitializeMimeTypes();
     }
 
     template <typename Request, typename Send>
     void operator()(Request&& req, Send&& send) {
-        // Преобразуем boost::string_view в std::string для сравнения
-        std::string target_str(req.target().data(), req.target().size());
-        string_view target = target_str;
+        const string_view target = req.target();
 
         // Проверяем, является ли запрос API-запросом
-        if (target.find(API_PREFIX) == 0) {
-            HandleApiRequest(std::move(req), std::forward<Send>(send));
+        if (target.starts_with(API_PREFIX)) {
+            ApiRouter::Match match;
+            {
+                TRACE_SCOPE("route");
+                match = ROUTER.Find(req.method(), target);
+            }
+            const Route route = GetApiRoute(match);
+            SetRoute(route);
+            if (RejectIfRateLimited(route, req, send)) {
+                return;
+            }
+            HandleApiRequest(std::move(req), std::forward<Send>(send), match);
+        } else if (target == METRICS_ENDPOINT) {
+            SetRoute(Route::kMetrics);
+            if (RejectIfRateLimited(Route::kMetrics, req, send)) {
+                return;
+            }
+            HandleMetrics(std::move(req), std::forward<Send>(send));
         } else {
             // Иначе обрабатываем как статический контент
+            SetRoute(Route::kStatic);
+            if (RejectIfRateLimited(Route::kStatic, req, send)) {
+                return;
+            }
             HandleStaticContent(std::move(req), std::forward<Send>(send));
         }
     }
 
 private:
     model::Game& game_;
+    const http_server::Metrics& metrics_;
     std::string static_path_;
+    StaticCache static_cache_;
+    RateLimiter rate_limiter_;
     std::unordered_map<std::string, std::string> mime_types_;
 
     void InitializeMimeTypes() {
@@ -76,90 +134,170 @@ private:
     }
 
 template <typename Body, typename Allocator, typename Send>
-void HandleApiRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-    std::string target_str(req.target().data(), req.target().size());
-    string_view target = target_str;
-
-    if (target == MAPS_LIST_ENDPOINT && req.method() == http::verb::get) {
-        HandleGetMapsList(std::move(req), std::forward<Send>(send));
-    } else if (target.find(MAP_BY_ID_ENDPOINT_PREFIX) == 0 && req.method() == http::verb::get) {
-        HandleGetMap(std::move(req), std::forward<Send>(send));
-    } else if (target == JOIN_GAME_ENDPOINT && req.method() == http::verb::post) {
-        HandleJoinGame(std::move(req), std::forward<Send>(send));
-    } else {
+void HandleApiRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send,
+                      const ApiRouter::Match& match) {
+    if (!match.route && match.allowed) {
+        // Путь известен, но не для этого метода
+        HandleInvalidApiMethod(std::move(req), std::forward<Send>(send), match.allowed);
+        return;
+    }
+    if (!match.route) {
         // Для неизвестных API endpoint возвращаем 400 (а не 404)
         HandleBadRequest(std::move(req), std::forward<Send>(send), "Bad API request");
+        return;
+    }
+
+    switch (match.route->endpoint) {
+        case Endpoint::kMapsList:
+            HandleGetMapsList(std::move(req), std::forward<Send>(send));
+            break;
+        case Endpoint::kMapById:
+            HandleGetMap(std::move(req), std::forward<Send>(send), match.param);
+            break;
+        case Endpoint::kJoinGame:
+            HandleJoinGame(std::move(req), std::forward<Send>(send));
+            break;
     }
 }
 
     template <typename Body, typename Allocator, typename Send>
     void HandleStaticContent(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+        TRACE_SCOPE("static");
         // Проверяем метод - только GET и HEAD разрешены для статики
         if (req.method() != http::verb::get && req.method() != http::verb::head) {
             HandleMethodNotAllowed(std::move(req), std::forward<Send>(send));
             return;
         }
 
-        // Декодируем URL
-        std::string target_str(req.target().data(), req.target().size());
-        std::string decoded_path = UrlDecode(target_str);
-
-        // Убираем начальный слэш если есть
-        if (!decoded_path.empty() && decoded_path[0] == '/') {
-            decoded_path = decoded_path.substr(1);
+        // Декодируем URL, пропуская начальный слэш
+        string_view target = req.target();
+        if (target.starts_with('/')) {
+            target.remove_prefix(1);
         }
+        std::string decoded_path = UrlDecode(target);
 
         // Если путь пустой или заканчивается на /, добавляем index.html
         if (decoded_path.empty() || decoded_path.back() == '/') {
             decoded_path += "index.html";
         }
 
-        // Строим полный путь к файлу
-        fs::path file_path = fs::path(static_path_) / decoded_path;
-
-        // Проверяем, что путь не выходит за пределы корневой директории
-        if (!IsPathWithinRoot(file_path, static_path_)) {
+        // Путь к файлу относительно каталога статики. Пути, ведущие за его пределы, отклоняем
+        const fs::path relative_path = fs::path(decoded_path).lexically_normal();
+        if (!IsPathWithinRoot(relative_path)) {
             HandleBadRequest(std::move(req), std::forward<Send>(send), "Invalid path");
             return;
         }
 
-        // Проверяем существование файла
-        if (!fs::exists(file_path) || !fs::is_regular_file(file_path)) {
+        // Определяем MIME-тип
+        std::string content_type = GetMimeType(relative_path.extension().string());
+
+        // Файлы, известные кешу, обслуживаются без обращения к диску
+        if (const auto* asset = static_cache_.Find(relative_path.generic_string())) {
+            SendCachedAsset(std::move(req), std::forward<Send>(send), *asset, content_type);
+            return;
+        }
+
+        // Файл появился или изменился после запуска сервера либо слишком велик для кеша. Размер файла узнаём одним вызовом stat().
+        // Для каталогов и несуществующих путей file_size возвращает ошибку
+        const fs::path file_path = fs::path(static_path_) / relative_path;
+        std::error_code size_ec;
+        const auto file_size = fs::file_size(file_path, size_ec);
+        if (size_ec) {
             HandleFileNotFound(std::move(req), std::forward<Send>(send));
             return;
         }
 
-        // Читаем файл
-        std::ifstream file(file_path, std::ios::binary);
-        if (!file) {
-           HandleFileNotFound(std::move(req), std::forward<Send>(send));
+        // На HEAD-запрос отвечаем только заголовками, не открывая файл
+        if (req.method() == http::verb::head) {
+            auto response = MakeHeadResponse(req, content_type, file_size);
+            send(std::move(response));
             return;
         }
+        SendFile(std::move(req), std::forward<Send>(send), file_path, content_type);
+    }
 
-        // Получаем размер файла
-        file.seekg(0, std::ios::end);
-        size_t file_size = file.tellg();
-        file.seekg(0, std::ios::beg);
+    template <typename Body, typename Allocator, typename Send>
+    void SendCachedAsset(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send,
+                         const StaticCache::Asset& asset, const std::string& content_type) {
+        // Сжатые представления подготовлены заранее, здесь только выбирается подходящее
+        const auto* encoded = StaticCache::SelectEncoding(asset, req[http::field::accept_encoding]);
+
+        if (StaticCache::IsNotModified(asset, encoded, req[http::field::if_none_match],
+                                       req[http::field::if_modified_since])) {
+            auto response = CreateResponse<http::empty_body>(req, http::status::not_modified);
+            SetCacheHeaders(response, asset, encoded);
+            response.keep_alive(req.keep_alive());
+            send(std::move(response));
+            return;
+        }
 
-        // Читаем содержимое файла
-        std::string file_content;
-        file_content.resize(file_size);
-        file.read(file_content.data(), file_size);
+        if (req.method() == http::verb::head) {
+            auto response = MakeHeadResponse(req, content_type, encoded ? encoded->body->size() : asset.size);
+            SetCacheHeaders(response, asset, encoded);
+            send(std::move(response));
+            return;
+        }
 
-        // Определяем MIME-тип
-        std::string content_type = GetMimeType(file_path.extension().string());
+        if (auto body = encoded ? encoded->body : static_cache_.GetBody(asset)) {
+            auto response = CreateResponse<SharedBody>(req, http::status::ok);
+            response.set(http::field::content_type, content_type);
+            SetCacheHeaders(response, asset, encoded);
+            response.body() = std::move(body);
+            response.prepare_payload();
+            response.keep_alive(req.keep_alive());
+            send(std::move(response));
+            return;
+        }
+
+        // Файл изменился после запуска сервера - отдаём его с диска без заголовков кеша,
+        // которые описывают прежнее содержимое
+        SendFile(std::move(req), std::forward<Send>(send), asset.path, content_type);
+    }
+
+    // Отдаёт файл, не читая его в память: file_body передаёт содержимое при записи ответа в сокет
+    template <typename Body, typename Allocator, typename Send>
+    void SendFile(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send,
+                  const fs::path& file_path, const std::string& content_type) {
+        http::file_body::value_type file;
+        beast::error_code open_ec;
+        file.open(file_path.c_str(), beast::file_mode::scan, open_ec);
+        if (open_ec) {
+            HandleFileNotFound(std::move(req), std::forward<Send>(send));
+            return;
+        }
 
-        // Создаем ответ
-        http::response<http::string_body> response{http::status::ok, req.version()};
+        auto response = CreateResponse<http::file_body>(req, http::status::ok, std::move(file));
         response.set(http::field::content_type, content_type);
-        response.set(http::field::content_length, std::to_string(file_size));
-        response.body() = (req.method() == http::verb::head) ? "" : file_content;
         response.prepare_payload();
         response.keep_alive(req.keep_alive());
 
         send(std::move(response));
     }
 
+    template <typename Request>
+    auto MakeHeadResponse(const Request& req, const std::string& content_type, std::uint64_t content_length) {
+        auto response = CreateResponse<http::empty_body>(req, http::status::ok);
+        response.set(http::field::content_type, content_type);
+        response.content_length(content_length);
+        response.keep_alive(req.keep_alive());
+        return response;
+    }
+
+    template <typename Response>
+    static void SetCacheHeaders(Response& response, const StaticCache::Asset& asset,
+                                const StaticCache::Encoded* encoded) {
+        response.set(http::field::etag, encoded ? encoded->etag : asset.etag);
+        response.set(http::field::last_modified, asset.last_modified);
+        response.set(http::field::cache_control, StaticCache::CACHE_CONTROL);
+        if (!asset.encoded.empty()) {
+            // Ответ зависит от Accept-Encoding, и промежуточные кеши должны это учитывать
+            response.set(http::field::vary, "Accept-Encoding");
+        }
+        if (encoded) {
+            response.set(http::field::content_encoding, encoded->encoding);
+        }
+    }
+
     template <typename Body, typename Allocator, typename Send>
 void HandleApiNotFound(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
     // Для неизвестных API endpoint - 404
@@ -171,7 +309,7 @@ void HandleApiNotFound(http::request<Body, http::basic_fields<Allocator>>&& req,
 template <typename Body, typename Allocator, typename Send>
 void HandleFileNotFound(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
     // Для несуществующих файлов - 404
-    http::response<http::string_body> response{http::status::not_found, req.version()};
+    auto response = CreateResponse<http::string_body>(req, http::status::not_found);
     response.set(http::field::content_type, "text/plain");
     response.body() = "File Not Found";
     response.prepare_payload();
@@ -179,16 +317,16 @@ void HandleFileNotFound(http::request<Body, http::basic_fields<Allocator>>&& req
     send(std::move(response));
 }
 
-    std::string UrlDecode(const std::string& encoded) {
+    static std::string UrlDecode(string_view encoded) {
         std::string decoded;
         decoded.reserve(encoded.size());
         
         for (size_t i = 0; i < encoded.size(); ++i) {
             if (encoded[i] == '%' && i + 2 < encoded.size()) {
-                int hex_value;
-                std::istringstream hex_stream(encoded.substr(i + 1, 2));
-                if (hex_stream >> std::hex >> hex_value) {
-                    decoded += static_cast<char>(hex_value);
+                const int high = HexDigitValue(encoded[i + 1]);
+                const int low = HexDigitValue(encoded[i + 2]);
+                if (high >= 0 && low >= 0) {
+                    decoded += static_cast<char>(high * 16 + low);
                     i += 2;
                 } else {
                     decoded += encoded[i];
@@ -203,45 +341,23 @@ void HandleFileNotFound(http::request<Body, http::basic_fields<Allocator>>&& req
         return decoded;
     }
 
-bool IsPathWithinRoot(const fs::path& path, const std::string& root) {
-    /* try {
-        // Простая проверка: если путь содержит "..", считаем небезопасным
-        std::string path_str = path.string();
-        if (path_str.find("..") != std::string::npos) {
-            return false;
+    static int HexDigitValue(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
         }
-        
-        // Более надежная проверка через canonical paths
-        fs::path abs_root = fs::absolute(root);
-        fs::path abs_path = fs::absolute(path);
-        
-        // Нормализуем пути
-        fs::path norm_root = abs_root.lexically_normal();
-        fs::path norm_path = abs_path.lexically_normal();
-        
-        // Преобразуем в строки для сравнения
-        std::string root_str = norm_root.string();
-        std::string path_str_final = norm_path.string();
-        
-        // Путь должен начинаться с корневой директории
-        bool result = (path_str_final.find(root_str) == 0);
-        
-        // Отладочный вывод (можно убрать после отладки)
-        // std::cout << "Root: " << root_str << std::endl;
-        // std::cout << "Path: " << path_str_final << std::endl;
-        // std::cout << "Result: " << result << std::endl;
-        
-        return result;
-        
-    } catch (const fs::filesystem_error& e) {
-        // В случае ошибки файловой системы считаем путь небезопасным
-        return false;
-    // }
-    */
-
-    std::cout << "DEBUG: IsPathWithinRoot - ALWAYS RETURNING TRUE" << std::endl;
-    return true;
-}
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    // Проверяет, что нормализованный относительный путь не выходит за пределы каталога статики
+    static bool IsPathWithinRoot(const fs::path& relative_path) {
+        return !relative_path.has_root_path() && (relative_path.empty() || *relative_path.begin() != "..");
+    }
 
     std::string GetMimeType(const std::string& extension) {
         std::string ext_lower = extension;
@@ -255,33 +371,16 @@ bool IsPathWithinRoot(const fs::path& path, const std::string& root) {
         return "application/octet-stream";
     }
 
-    // API методы (остаются как были)
+    // Карты не меняются после загрузки, поэтому их JSON готовится один раз в json_loader.
+    // Ответ лишь ссылается на готовый буфер
     template <typename Body, typename Allocator, typename Send>
     void HandleGetMapsList(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-        boost::json::array maps_array;
-
-        const auto& maps = game_.GetMaps();
-        for (const auto& map : maps) {
-            boost::json::object map_obj;
-            map_obj["id"] = *map.GetId();
-            map_obj["name"] = map.GetName();
-
-            maps_array.push_back(std::move(map_obj));
-        }
-
-        std::string json = boost::json::serialize(maps_array);
-
-        auto response = MakeResponse(std::move(req), json, http::status::ok);
-        send(std::move(response));
+        SendSerialized(std::move(req), std::forward<Send>(send), game_.GetSerializedMaps());
     }
 
     template <typename Body, typename Allocator, typename Send>
-    void HandleGetMap(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-        auto target = req.target();
-        std::string target_str(target.data(), target.size());
-        std::string map_id_str = target_str.substr(MAP_BY_ID_ENDPOINT_PREFIX.length());
-
-        model::Map::Id map_id(map_id_str);
+    void HandleGetMap(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, string_view id) {
+        model::Map::Id map_id{std::string(id)};
         const auto* map = game_.FindMap(map_id);
 
         if (!map) {
@@ -291,64 +390,42 @@ bool IsPathWithinRoot(const fs::path& path, const std::string& root) {
             return;
         }
 
-        // ... остальная логика HandleGetMap (как у вас было)
-        std::string json = "{";
-        json += "\"id\":\"" + std::string(*map->GetId()) + "\",";
-        json += "\"name\":\"" + map->GetName() + "\",";
-
-        // Roads
-        json += "\"roads\":[";
-        const auto& roads = map->GetRoads();
-        for (size_t i = 0; i < roads.size(); ++i) {
-            const auto& road = roads[i];
-            if (road.IsHorizontal()) {
-                json += "{\"x0\":" + std::to_string(road.GetStart().x) + 
-                        ",\"y0\":" + std::to_string(road.GetStart().y) + 
-                        ",\"x1\":" + std::to_string(road.GetEnd().x) + "}";
-            } else {
-                json += "{\"x0\":" + std::to_string(road.GetStart().x) + 
-                        ",\"y0\":" + std::to_string(road.GetStart().y) + 
-                        ",\"y1\":" + std::to_string(road.GetEnd().y) + "}";
-            }
-            if (i != roads.size() - 1) {
-                json += ",";
-            }
-        }
-        json += "],";
-
-        // Buildings
-        json += "\"buildings\":[";
-        const auto& buildings = map->GetBuildings();
-        for (size_t i = 0; i < buildings.size(); ++i) {
-            const auto& bounds = buildings[i].GetBounds();
-            json += "{\"x\":" + std::to_string(bounds.position.x) + 
-                    ",\"y\":" + std::to_string(bounds.position.y) + 
-                    ",\"w\":" + std::to_string(bounds.size.width) + 
-                    ",\"h\":" + std::to_string(bounds.size.height) + "}";
-            if (i != buildings.size() - 1) {
-                json += ",";
-            }
+        // Представление карты выбирается по заголовку Accept: JSON или двоичное
+        if (binary_encoding::PrefersBinary(req[http::field::accept])) {
+            SendSerialized(std::move(req), std::forward<Send>(send), map->GetSerializedBinary(),
+                           binary_encoding::CONTENT_TYPE, true);
+        } else {
+            SendSerialized(std::move(req), std::forward<Send>(send), map->GetSerialized(), "application/json",
+                           true);
         }
-        json += "],";
-
-        // Offices
-        json += "\"offices\":[";
-        const auto& offices = map->GetOffices();
-        for (size_t i = 0; i < offices.size(); ++i) {
-            json += "{\"id\":\"" + std::string(*offices[i].GetId()) + 
-                    "\",\"x\":" + std::to_string(offices[i].GetPosition().x) + 
-                    ",\"y\":" + std::to_string(offices[i].GetPosition().y) + 
-                    ",\"offsetX\":" + std::to_string(offices[i].GetOffset().dx) + 
-                    ",\"offsetY\":" + std::to_string(offices[i].GetOffset().dy) + "}";
-            if (i != offices.size() - 1) {
-                json += ",";
+    }
+
+    // vary_by_accept - представление выбрано по заголовку Accept, о чём сообщается кэшам
+    template <typename Body, typename Allocator, typename Send>
+    void SendSerialized(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send,
+                        const model::Serialized& serialized, string_view content_type = "application/json",
+                        bool vary_by_accept = false) {
+        TRACE_SCOPE("serialize");
+        if (util::MatchesETag(req[http::field::if_none_match], serialized.etag)) {
+            auto response = CreateResponse<http::empty_body>(req, http::status::not_modified);
+            response.set(http::field::etag, serialized.etag);
+            if (vary_by_accept) {
+                response.set(http::field::vary, "Accept");
             }
+            response.keep_alive(req.keep_alive());
+            send(std::move(response));
+            return;
         }
-        json += "]";
 
-        json += "}";
-
-        auto response = MakeResponse(std::move(req), json, http::status::ok);
+        auto response = CreateResponse<SharedBody>(req, http::status::ok);
+        response.set(http::field::content_type, content_type);
+        response.set(http::field::etag, serialized.etag);
+        if (vary_by_accept) {
+            response.set(http::field::vary, "Accept");
+        }
+        response.body() = serialized.data;
+        response.prepare_payload();
+        response.keep_alive(req.keep_alive());
         send(std::move(response));
     }
 
@@ -359,9 +436,81 @@ bool IsPathWithinRoot(const fs::path& path, const std::string& root) {
         send(std::move(response));
     }
 
+    template <typename Body, typename Allocator, typename Send>
+    void HandleMetrics(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+        if (req.method() != http::verb::get) {
+            HandleMethodNotAllowed(std::move(req), std::forward<Send>(send));
+            return;
+        }
+        auto response = CreateResponse<http::string_body>(req, http::status::ok);
+        response.set(http::field::content_type, "text/plain; version=0.0.4");
+        response.set(http::field::cache_control, "no-cache");
+        {
+            TRACE_SCOPE("serialize");
+            response.body() = metrics_.Render();
+        }
+        response.prepare_payload();
+        response.keep_alive(req.keep_alive());
+        send(std::move(response));
+    }
+
+    // Маршрут API-запроса. Запросы с неподходящим методом относятся к неизвестному маршруту
+    static Route GetApiRoute(const ApiRouter::Match& match) {
+        if (!match.route) {
+            return Route::kOther;
+        }
+        switch (match.route->endpoint) {
+            case Endpoint::kMapsList:
+                return Route::kMapsList;
+            case Endpoint::kMapById:
+                return Route::kMap;
+            case Endpoint::kJoinGame:
+                return Route::kJoinGame;
+        }
+        return Route::kOther;
+    }
+
+    // Проверяется до разбора тела и сериализации, чтобы отклонённый запрос обходился дёшево.
+    // Запросы учитываются по адресу клиента: токен авторизации здесь ещё не проверен,
+    // и клиент, меняющий токены, обходил бы ограничение.
+    // Возвращает true, если запрос отклонён и клиенту отправлен ответ 429
+    template <typename Request, typename Send>
+    bool RejectIfRateLimited(Route route, const Request& req, Send& send) {
+        const auto route_id = static_cast<std::size_t>(route);
+        if (!rate_limiter_.IsLimited(route_id)) {
+            return false;
+        }
+        const auto decision =
+            rate_limiter_.TryAcquire(route_id, RateLimiter::HashAddress(http_server::GetRequestRemoteAddress()));
+        if (decision.allowed) {
+            return false;
+        }
+
+        // Retry-After указывается в целых секундах, округляем вверх
+        const auto retry_after = std::chrono::ceil<std::chrono::seconds>(decision.retry_after);
+        auto response = CreateResponse<http::string_body>(req, http::status::too_many_requests);
+        response.set(http::field::retry_after, std::to_string(std::max<std::int64_t>(1, retry_after.count())));
+        response.set(http::field::cache_control, "no-cache");
+        if (string_view(req.target()).starts_with(API_PREFIX)) {
+            response.set(http::field::content_type, "application/json");
+            response.body() = R"({"code":"tooManyRequests","message":"Too many requests"})";
+        } else {
+            response.set(http::field::content_type, "text/plain");
+            response.body() = "Too Many Requests";
+        }
+        response.prepare_payload();
+        response.keep_alive(req.keep_alive());
+        send(std::move(response));
+        return true;
+    }
+
+    static void SetRoute(Route route) {
+        http_server::SetRequestRoute(static_cast<http_server::RouteId>(route));
+    }
+
     template <typename Body, typename Allocator, typename Send>
     void HandleMethodNotAllowed(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-        http::response<http::string_body> response{http::status::method_not_allowed, req.version()};
+        auto response = CreateResponse<http::string_body>(req, http::status::method_not_allowed);
         response.set(http::field::content_type, "text/plain");
         response.body() = "Method Not Allowed";
         response.prepare_payload();
@@ -369,21 +518,35 @@ bool IsPathWithinRoot(const fs::path& path, const std::string& root) {
         send(std::move(response));
     }
 
+    // Отвечает 405 с перечнем допустимых методов в заголовке Allow
+    template <typename Body, typename Allocator, typename Send>
+    void HandleInvalidApiMethod(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send,
+                                std::uint64_t allowed) {
+        std::string allow;
+        for (unsigned verb = 0; verb < 64; ++verb) {
+            if (allowed & ApiRouter::VerbBit(static_cast<http::verb>(verb))) {
+                allow += allow.empty() ? "" : ", ";
+                allow += http::to_string(static_cast<http::verb>(verb));
+            }
+        }
+        std::string error_json = R"({"code":"invalidMethod","message":"Invalid method"})";
+        auto response = MakeResponse(std::move(req), error_json, http::status::method_not_allowed);
+        response.set(http::field::allow, allow);
+        send(std::move(response));
+    }
+
     template <typename Body, typename Allocator, typename Send>
 void HandleBadRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, 
                      const std::string& message = "Bad request") {
     // Для API bad request возвращаем JSON
-    std::string target_str(req.target().data(), req.target().size());
-    string_view target = target_str;
-    
-    if (target.find(API_PREFIX) == 0) {
+    if (string_view(req.target()).starts_with(API_PREFIX)) {
         // API запросы - возвращаем JSON
         std::string error_json = R"({"code":"badRequest","message":")" + message + "\"}";
         auto response = MakeResponse(std::move(req), error_json, http::status::bad_request);
         send(std::move(response));
     } else {
         // Статические запросы - возвращаем plain text
-        http::response<http::string_body> response{http::status::bad_request, req.version()};
+        auto response = CreateResponse<http::string_body>(req, http::status::bad_request);
         response.set(http::field::content_type, "text/plain");
         response.body() = message;
         response.prepare_payload();
@@ -394,7 +557,7 @@ void HandleBadRequest(http::request<Body, http::basic_fields<Allocator>>&& req,
 
     template <typename Body, typename Allocator, typename Send>
     void HandleNotFound(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-        http::response<http::string_body> response{http::status::not_found, req.version()};
+        auto response = CreateResponse<http::string_body>(req, http::status::not_found);
         response.set(http::field::content_type, "text/plain");
         response.body() = "File Not Found";
         response.prepare_payload();
@@ -402,13 +565,27 @@ void HandleBadRequest(http::request<Body, http::basic_fields<Allocator>>&& req,
         send(std::move(response));
     }
 
+    // Создаёт ответ, поля заголовка которого размещаются тем же аллокатором, что и поля запроса.
+    // Сессия сервера читает запросы в свою арену, поэтому заголовки ответа тоже не обращаются
+    // к общей куче
+    template <typename ResponseBody, typename Body, typename Allocator, typename... BodyArgs>
+    static http::response<ResponseBody, http::basic_fields<Allocator>> CreateResponse(
+        const http::request<Body, http::basic_fields<Allocator>>& req, http::status status, BodyArgs&&... body_args) {
+        http::response<ResponseBody, http::basic_fields<Allocator>> response{
+            std::piecewise_construct, std::forward_as_tuple(std::forward<BodyArgs>(body_args)...),
+            std::make_tuple(req.get_allocator())};
+        response.result(status);
+        response.version(req.version());
+        return response;
+    }
+
     template <typename Body, typename Allocator>
-    http::response<http::string_body> MakeResponse(
+    http::response<http::string_body, http::basic_fields<Allocator>> MakeResponse(
         http::request<Body, http::basic_fields<Allocator>>&& req,
         const std::string& data,
         http::status status) {
 
-        http::response<http::string_body> response{status, req.version()};
+        auto response = CreateResponse<http::string_body>(req, status);
         response.set(http::field::content_type, "application/json");
         response.body() = data;
         response.prepare_payload();
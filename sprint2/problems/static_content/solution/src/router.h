@@ -0,0 +1,158 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/beast/http/verb.hpp>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace http_handler {
+
+namespace http = boost::beast::http;
+
+// Таблица маршрутов, построенная на этапе компиляции.
+// Пути маршрутов раскладываются по ячейкам идеальной хеш-функции: значение seed
+// подбирается так, чтобы у всех различных путей были разные ячейки. Поэтому поиск маршрута
+// занимает одно вычисление хеша и одно сравнение строк независимо от числа маршрутов.
+// Один путь может быть зарегистрирован для нескольких методов: такие маршруты связаны
+// в цепочку, начинающуюся в ячейке пути.
+// Маршрут-префикс (например, "/api/v1/maps/") соответствует путям вида префикс + параметр,
+// параметр возвращается как string_view на часть исходного target без копирования
+template <typename Endpoint, size_t N>
+class Router {
+public:
+    enum class MatchKind { kExact, kPrefix };
+
+    struct Route {
+        std::string_view path;
+        MatchKind kind;
+        http::verb method;
+        Endpoint endpoint;
+    };
+
+    struct Match {
+        // nullptr, если маршрут не найден или путь найден, но не для этого метода
+        const Route* route = nullptr;
+        // Часть пути после префикса для маршрутов kPrefix
+        std::string_view param;
+        // Методы, для которых зарегистрирован найденный путь: бит с номером http::verb.
+        // Если путь найден, а route равен nullptr, на запрос отвечают 405 Method Not Allowed
+        std::uint64_t allowed = 0;
+    };
+
+    constexpr explicit Router(const std::array<Route, N>& routes)
+        : routes_(routes)
+        , seed_(FindSeed(routes)) {
+        slots_.fill(EMPTY_SLOT);
+        next_same_path_.fill(EMPTY_SLOT);
+        // Обход с конца оставляет в ячейке первый из маршрутов с одинаковым путём
+        for (size_t i = N; i-- > 0;) {
+            std::int16_t& slot = slots_[Slot(routes_[i].path, seed_)];
+            if (slot != EMPTY_SLOT && routes_[slot].path == routes_[i].path) {
+                next_same_path_[i] = slot;
+            }
+            slot = static_cast<std::int16_t>(i);
+        }
+    }
+
+    // Ищет маршрут для метода и target запроса. Строка запроса (после '?') не учитывается
+    constexpr Match Find(http::verb method, std::string_view target) const {
+        const std::string_view path = target.substr(0, target.find('?'));
+        if (Match match = MatchPath(Lookup(path), MatchKind::kExact, method); match.allowed) {
+            return match;
+        }
+        // Префиксом маршрута считается путь вплоть до одного из символов '/',
+        // параметром — весь остаток пути (он может быть пустым или содержать '/')
+        for (auto slash = path.find('/'); slash != std::string_view::npos; slash = path.find('/', slash + 1)) {
+            if (Match match = MatchPath(Lookup(path.substr(0, slash + 1)), MatchKind::kPrefix, method);
+                match.allowed) {
+                match.param = path.substr(slash + 1);
+                return match;
+            }
+        }
+        return {};
+    }
+
+    static constexpr std::uint64_t VerbBit(http::verb method) {
+        return std::uint64_t{1} << static_cast<unsigned>(method);
+    }
+
+private:
+    static constexpr size_t TABLE_SIZE = std::bit_ceil(N * 2 < 8 ? 8 : N * 2);
+    static constexpr std::int16_t EMPTY_SLOT = -1;
+
+    static constexpr size_t Slot(std::string_view path, std::uint32_t seed) {
+        // FNV-1a, в котором seed смешивается с начальным значением
+        std::uint32_t hash = 2166136261u ^ seed;
+        for (char c : path) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 16777619u;
+        }
+        return hash & (TABLE_SIZE - 1);
+    }
+
+    static constexpr std::uint32_t FindSeed(const std::array<Route, N>& routes) {
+        for (std::uint32_t seed = 0; seed < 0x10000; ++seed) {
+            std::array<bool, TABLE_SIZE> used{};
+            bool collision = false;
+            for (size_t i = 0; i < N; ++i) {
+                // Маршруты с уже встреченным путём займут ту же ячейку
+                if (IsRepeatedPath(routes, i)) {
+                    continue;
+                }
+                const size_t slot = Slot(routes[i].path, seed);
+                collision = collision || used[slot];
+                used[slot] = true;
+            }
+            if (!collision) {
+                return seed;
+            }
+        }
+        // При вычислении на этапе компиляции превращается в ошибку компиляции
+        throw std::logic_error("Perfect hash seed for routes not found");
+    }
+
+    static constexpr bool IsRepeatedPath(const std::array<Route, N>& routes, size_t index) {
+        for (size_t i = 0; i < index; ++i) {
+            if (routes[i].path == routes[index].path) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Возвращает номер первого маршрута с путём path или EMPTY_SLOT
+    constexpr std::int16_t Lookup(std::string_view path) const {
+        const std::int16_t index = slots_[Slot(path, seed_)];
+        if (index == EMPTY_SLOT || routes_[index].path != path) {
+            return EMPTY_SLOT;
+        }
+        return index;
+    }
+
+    // Выбирает из цепочки маршрутов одного пути маршрут вида kind для метода method
+    constexpr Match MatchPath(std::int16_t index, MatchKind kind, http::verb method) const {
+        Match match;
+        for (; index != EMPTY_SLOT; index = next_same_path_[index]) {
+            const Route& route = routes_[index];
+            if (route.kind != kind) {
+                continue;
+            }
+            match.allowed |= VerbBit(route.method);
+            if (route.method == method && !match.route) {
+                match.route = &route;
+            }
+        }
+        return match;
+    }
+
+    std::array<Route, N> routes_;
+    std::uint32_t seed_;
+    std::array<std::int16_t, TABLE_SIZE> slots_{};
+    // Следующий маршрут с тем же путём или EMPTY_SLOT
+    std::array<std::int16_t, N> next_same_path_{};
+};
+
+}  // namespace http_handler
@@ -2,3 +2,7 @@
 #ifdef WIN32
 #include <sdkddkver.h>
 #endif
+// boost.beast будет использовать std::string_view вместо boost::string_view.
+// Макрос должен быть одинаковым во всех единицах трансляции, поэтому он задаётся здесь,
+// а sdk.h подключается первым
+#define BOOST_BEAST_USE_STD_STRING_VIEW
@@ -0,0 +1,51 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+#include <memory>
+#include <string>
+
+namespace http_handler {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Тело HTTP-ответа, ссылающееся на неизменяемый буфер с подсчётом ссылок.
+// Один и тот же буфер может одновременно отправляться в нескольких ответах без копирования
+struct SharedBody {
+    using value_type = std::shared_ptr<const std::string>;
+
+    static std::uint64_t size(const value_type& body) {
+        return body ? body->size() : 0;
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template <bool isRequest, typename Fields>
+        writer(const http::header<isRequest, Fields>&, const value_type& body)
+            : body_(body) {
+        }
+
+        void init(beast::error_code& ec) {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+            ec = {};
+            if (!body_ || body_->empty()) {
+                return boost::none;
+            }
+            return {{net::const_buffer(body_->data(), body_->size()), false}};
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
+
+}  // namespace http_handler
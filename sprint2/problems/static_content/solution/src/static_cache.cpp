@@ -0,0 +1,280 @@
+#include "static_cache.h"
+
+#include <brotli/encode.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <optional>
+
+#include "etag.h"
+#include "header_values.h"
+
+namespace http_handler {
+
+namespace fs = std::filesystem;
+using namespace std::literals;
+
+namespace {
+
+constexpr const char* HTTP_DATE_FORMAT = "%a, %d %b %Y %H:%M:%S GMT";
+
+// Расширения файлов, которые имеет смысл сжимать. Изображения и модели уже сжаты
+constexpr std::array COMPRESSIBLE_EXTENSIONS = {".html"sv, ".htm"sv, ".css"sv, ".txt"sv, ".js"sv,
+                                                ".json"sv, ".xml"sv, ".svg"sv};
+
+// Качество 11 сжимает three.js лишь на 10% лучше, но в 25 раз медленнее, что заметно
+// задерживает запуск сервера
+constexpr int BROTLI_QUALITY = 9;
+
+bool IsCompressible(const fs::path& path) {
+    const std::string extension = path.extension().string();
+    return std::find(COMPRESSIBLE_EXTENSIONS.begin(), COMPRESSIBLE_EXTENSIONS.end(), extension)
+           != COMPRESSIBLE_EXTENSIONS.end();
+}
+
+std::optional<std::string> GzipCompress(const std::string& content) {
+    z_stream stream{};
+    // windowBits 15 + 16 включает формат gzip вместо zlib
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return std::nullopt;
+    }
+    std::string compressed(deflateBound(&stream, content.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+    stream.avail_in = static_cast<uInt>(content.size());
+    stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    const int result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        return std::nullopt;
+    }
+    return compressed;
+}
+
+std::optional<std::string> BrotliCompress(const std::string& content) {
+    std::size_t size = BrotliEncoderMaxCompressedSize(content.size());
+    if (size == 0) {
+        return std::nullopt;
+    }
+    std::string compressed(size, '\0');
+    if (!BrotliEncoderCompress(BROTLI_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, content.size(),
+                               reinterpret_cast<const uint8_t*>(content.data()), &size,
+                               reinterpret_cast<uint8_t*>(compressed.data()))) {
+        return std::nullopt;
+    }
+    compressed.resize(size);
+    return compressed;
+}
+
+std::optional<std::string> ReadFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad()) {
+        return std::nullopt;
+    }
+    return content;
+}
+
+// Форматирует момент времени как HTTP-date (RFC 9110, раздел 5.6.7)
+std::string FormatHttpDate(std::chrono::system_clock::time_point tp) {
+    const std::time_t time = std::chrono::system_clock::to_time_t(tp);
+    std::tm tm{};
+    gmtime_r(&time, &tm);
+    char buffer[64];
+    const size_t length = std::strftime(buffer, sizeof(buffer), HTTP_DATE_FORMAT, &tm);
+    return {buffer, length};
+}
+
+std::optional<std::chrono::system_clock::time_point> ParseHttpDate(std::string_view value) {
+    const std::string str(value);
+    std::tm tm{};
+    if (const char* end = strptime(str.c_str(), HTTP_DATE_FORMAT, &tm); !end || *end != '\0') {
+        return std::nullopt;
+    }
+    return std::chrono::system_clock::from_time_t(timegm(&tm));
+}
+
+// Возвращает q-значение кодировки encoding в заголовке Accept-Encoding (RFC 9110, раздел 12.5.3).
+// Кодировка, не указанная явно, получает значение элемента "*", а при его отсутствии - 0
+double GetEncodingQuality(std::string_view accept_encoding, std::string_view encoding) {
+    std::optional<double> quality;
+    std::optional<double> wildcard;
+    util::ForEachWeightedItem(accept_encoding, [&](std::string_view item, double item_quality) {
+        if (!quality && util::EqualsIgnoreCase(item, encoding)) {
+            quality = item_quality;
+        } else if (item == "*"sv) {
+            wildcard = item_quality;
+        }
+    });
+    return quality.value_or(wildcard.value_or(0.0));
+}
+
+}  // namespace
+
+StaticCache::StaticCache(fs::path root, std::size_t max_bytes)
+    : root_(std::move(root))
+    , max_body_bytes_(max_bytes - max_bytes / 4)
+    , max_encoded_bytes_(max_bytes / 4) {
+    if (root_.empty() || !fs::is_directory(root_)) {
+        return;
+    }
+    for (const auto& entry : fs::recursive_directory_iterator(root_)) {
+        std::error_code ec;
+        if (!entry.is_regular_file() || entry.file_size(ec) > max_body_bytes_ || ec) {
+            continue;
+        }
+        auto content = ReadFile(entry.path());
+        if (!content) {
+            continue;
+        }
+
+        // Asset содержит атомарный флаг и не перемещается, поэтому заполняется на месте
+        const std::string key = entry.path().lexically_relative(root_).generic_string();
+        auto [it, inserted] = assets_.try_emplace(key);
+        if (!inserted) {
+            continue;
+        }
+        Asset& asset = it->second;
+        asset.path = entry.path();
+        asset.size = content->size();
+        asset.etag = util::MakeETag(*content);
+        // HTTP-date хранит время с точностью до секунды
+        asset.modified_at = std::chrono::floor<std::chrono::seconds>(
+            std::chrono::file_clock::to_sys(entry.last_write_time()));
+        asset.last_modified = FormatHttpDate(asset.modified_at);
+
+        if (IsCompressible(entry.path())) {
+            PrepareEncodings(asset, *content);
+        }
+        // На старте кешируем файлы, пока они помещаются в лимит, ничего не вытесняя
+        if (resident_bytes_ + content->size() <= max_body_bytes_) {
+            Insert(asset, std::make_shared<const std::string>(std::move(*content)));
+        }
+    }
+}
+
+void StaticCache::PrepareEncodings(Asset& asset, const std::string& content) {
+    struct Codec {
+        std::string_view encoding;
+        std::string_view extension;
+        std::optional<std::string> (*compress)(const std::string&);
+    };
+    constexpr std::array CODECS = {Codec{"br"sv, ".br"sv, BrotliCompress}, Codec{"gzip"sv, ".gz"sv, GzipCompress}};
+
+    for (const Codec& codec : CODECS) {
+        // Готовый сжатый файл рядом с исходным (например, созданный при сборке) имеет приоритет
+        fs::path sibling = asset.path;
+        sibling += codec.extension;
+        std::error_code ec;
+        auto compressed = fs::is_regular_file(sibling, ec) ? ReadFile(sibling) : codec.compress(content);
+        // Сжатое представление хранится постоянно, поэтому должно помещаться в свой лимит
+        if (!compressed || compressed->size() >= content.size()
+            || encoded_bytes_ + compressed->size() > max_encoded_bytes_) {
+            continue;
+        }
+        encoded_bytes_ += compressed->size();
+        std::string etag = util::MakeETag(*compressed);
+        asset.encoded.push_back(
+            {codec.encoding, std::move(etag), std::make_shared<const std::string>(std::move(*compressed))});
+    }
+}
+
+const StaticCache::Asset* StaticCache::Find(const std::string& relative_path) const {
+    if (auto it = assets_.find(relative_path);
+        it != assets_.end() && !it->second.stale_.load(std::memory_order_relaxed)) {
+        return &it->second;
+    }
+    return nullptr;
+}
+
+StaticCache::Body StaticCache::GetBody(const Asset& asset) {
+    // Метаданные кеша неизменны, а изменяемые поля Asset защищены mutex_
+    auto& mutable_asset = const_cast<Asset&>(asset);
+    if (asset.stale_.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    {
+        std::lock_guard lock{mutex_};
+        if (mutable_asset.body_) {
+            lru_.splice(lru_.begin(), lru_, mutable_asset.lru_pos_);
+            return mutable_asset.body_;
+        }
+    }
+
+    // Файл читается без блокировки, чтобы не задерживать обращения к другим файлам
+    auto content = ReadFile(asset.path);
+    // Изменившийся файл не должен отдаваться с прежними ETag и Content-Length.
+    // Он помечается устаревшим, чтобы следующие запросы не читали и не хешировали его снова
+    if (!content || content->size() != asset.size || util::MakeETag(*content) != asset.etag) {
+        mutable_asset.stale_.store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+    std::lock_guard lock{mutex_};
+    if (mutable_asset.body_) {
+        // Пока файл читался, его уже загрузил другой поток
+        return mutable_asset.body_;
+    }
+    return Insert(mutable_asset, std::make_shared<const std::string>(std::move(*content)));
+}
+
+const StaticCache::Encoded* StaticCache::SelectEncoding(const Asset& asset, std::string_view accept_encoding) {
+    if (accept_encoding.empty()) {
+        return nullptr;
+    }
+    const Encoded* best = nullptr;
+    double best_quality = 0.0;
+    for (const Encoded& encoded : asset.encoded) {
+        // Представления упорядочены по предпочтению, поэтому при равном q остаётся первое
+        if (const double quality = GetEncodingQuality(accept_encoding, encoded.encoding); quality > best_quality) {
+            best = &encoded;
+            best_quality = quality;
+        }
+    }
+    return best;
+}
+
+bool StaticCache::IsNotModified(const Asset& asset, const Encoded* encoded, std::string_view if_none_match,
+                                std::string_view if_modified_since) {
+    // If-Modified-Since учитывается, только если клиент не прислал If-None-Match
+    if (!if_none_match.empty()) {
+        return util::MatchesETag(if_none_match, encoded ? encoded->etag : asset.etag);
+    }
+    if (!if_modified_since.empty()) {
+        const auto since = ParseHttpDate(if_modified_since);
+        return since && asset.modified_at <= *since;
+    }
+    return false;
+}
+
+StaticCache::Body StaticCache::Insert(Asset& asset, Body body) {
+    EvictToFit(body->size());
+    if (resident_bytes_ + body->size() > max_body_bytes_) {
+        // Места не нашлось - содержимое отдаётся, но не кешируется
+        return body;
+    }
+    resident_bytes_ += body->size();
+    lru_.push_front(&asset);
+    asset.lru_pos_ = lru_.begin();
+    asset.body_ = std::move(body);
+    return asset.body_;
+}
+
+void StaticCache::EvictToFit(std::size_t incoming_size) {
+    while (!lru_.empty() && resident_bytes_ + incoming_size > max_body_bytes_) {
+        Asset* victim = lru_.back();
+        lru_.pop_back();
+        resident_bytes_ -= victim->body_->size();
+        // Ответы, которые ещё отправляются, продолжают владеть буфером
+        victim->body_.reset();
+    }
+}
+
+}  // namespace http_handler
@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace http_handler {
+
+// Кеш статических файлов.
+// При создании обходит каталог со статикой и для каждого файла один раз вычисляет ETag по
+// содержимому и Last-Modified. Эти метаданные неизменны и доступны без блокировок, поэтому
+// условные запросы (If-None-Match, If-Modified-Since) обслуживаются без обращения к диску.
+// Файлы больше трёх четвертей max_bytes кеш не учитывает, их отдаёт обработчик запросов с диска.
+// Содержимое остальных хранится в памяти, пока их суммарный размер не превышает
+// три четверти max_bytes. При превышении вытесняются давно не запрашивавшиеся файлы (LRU).
+// Для текстовых файлов при создании кеша один раз готовятся сжатые представления
+// (brotli и gzip), которые выбираются по заголовку Accept-Encoding. Если рядом с файлом
+// лежат готовые file.br или file.gz, используются они. Сжатые представления не вытесняются
+// и занимают оставшуюся четверть max_bytes: не поместившиеся в неё не создаются
+class StaticCache {
+public:
+    using Body = std::shared_ptr<const std::string>;
+
+    // Сжатое представление файла
+    struct Encoded {
+        // Значение заголовка Content-Encoding
+        std::string_view encoding;
+        std::string etag;
+        Body body;
+    };
+
+    struct Asset {
+        std::filesystem::path path;
+        std::uint64_t size = 0;
+        std::string etag;
+        std::string last_modified;
+        std::chrono::system_clock::time_point modified_at;
+        // Сжатые представления в порядке предпочтения. Если вектор не пуст,
+        // ответ зависит от Accept-Encoding и требует заголовка Vary
+        std::vector<Encoded> encoded;
+
+    private:
+        friend class StaticCache;
+        // Файл изменился на диске после создания кеша. Такой файл кеш больше не отдаёт
+        std::atomic<bool> stale_{false};
+        // Поля ниже защищены мьютексом кеша
+        Body body_;
+        std::list<Asset*>::iterator lru_pos_;
+    };
+
+    // Значение заголовка Cache-Control для файлов из кеша.
+    // Браузер хранит копию, но перед использованием сверяет её ETag с сервером
+    static constexpr std::string_view CACHE_CONTROL = "public, no-cache";
+    static constexpr std::size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+    explicit StaticCache(std::filesystem::path root, std::size_t max_bytes = DEFAULT_MAX_BYTES);
+
+    StaticCache(const StaticCache&) = delete;
+    StaticCache& operator=(const StaticCache&) = delete;
+
+    // Ищет файл по пути относительно корня статики (в формате "js/game.js").
+    // Возвращает nullptr, если такого файла при создании кеша не было или он изменился позже
+    const Asset* Find(const std::string& relative_path) const;
+
+    // Возвращает содержимое файла. Если оно было вытеснено, читает его с диска снова.
+    // Возвращает nullptr, если файл не читается или изменился после создания кеша
+    // и больше не соответствует ETag и размеру из метаданных. Такой файл помечается
+    // устаревшим: до пересоздания кеша Find его не находит и диск повторно не читается
+    Body GetBody(const Asset& asset);
+
+    // Выбирает сжатое представление, допустимое по заголовку Accept-Encoding.
+    // Возвращает nullptr, если нужно отдать файл без сжатия
+    static const Encoded* SelectEncoding(const Asset& asset, std::string_view accept_encoding);
+
+    // Проверяет, актуальна ли копия клиента, по заголовкам If-None-Match и If-Modified-Since.
+    // encoded - выбранное представление файла или nullptr для несжатого
+    static bool IsNotModified(const Asset& asset, const Encoded* encoded, std::string_view if_none_match,
+                              std::string_view if_modified_since);
+
+private:
+    void PrepareEncodings(Asset& asset, const std::string& content);
+
+    Body Insert(Asset& asset, Body body);
+    void EvictToFit(std::size_t incoming_size);
+
+    std::filesystem::path root_;
+    // Лимиты для содержимого файлов и для сжатых представлений. Вместе не превышают max_bytes
+    std::size_t max_body_bytes_;
+    std::size_t max_encoded_bytes_;
+    // Байты сжатых представлений. Заполняется в конструкторе и дальше не меняется
+    std::size_t encoded_bytes_ = 0;
+    // Заполняется в конструкторе и дальше не меняется
+    std::unordered_map<std::string, Asset> assets_;
+
+    std::mutex mutex_;
+    // Файлы с содержимым в памяти, от недавно запрошенных к давно запрошенным
+    std::list<Asset*> lru_;
+    // Байты несжатого содержимого в памяти
+    std::size_t resident_bytes_ = 0;
+};
+
+}  // namespace http_handler
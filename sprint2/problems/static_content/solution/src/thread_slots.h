@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// Блоки данных объекта, по одному на каждый поток, который к нему обращался.
+// Поток находит свой блок через thread_local-кэш. Ключ кэша - уникальный номер объекта,
+// а не его адрес: адрес разрушенного объекта может достаться новому, и кэш указал бы
+// на освобождённый блок. Если поток поочерёдно обращается к разным объектам, свой блок
+// в каждом он находит по идентификатору потока, а не заводит новый
+template <typename T>
+class ThreadSlots {
+public:
+    ThreadSlots() = default;
+
+    ThreadSlots(const ThreadSlots&) = delete;
+    ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+    // Блок текущего потока. Мьютекс берётся, только когда кэш потока указывает на другой объект
+    T& Get() {
+        thread_local std::uint64_t cached_id = 0;
+        thread_local T* cached = nullptr;
+        if (cached_id != id_) {
+            cached = &FindOrCreate();
+            cached_id = id_;
+        }
+        return *cached;
+    }
+
+    // Вызывает fn для блоков всех потоков. Блоки могут одновременно изменяться своими потоками.
+    // Блоки живут, пока жив объект, поэтому указатели на них можно сохранить
+    template <typename Fn>
+    void ForEach(Fn&& fn) {
+        std::lock_guard lock{mutex_};
+        for (Slot& slot : slots_) {
+            fn(*slot.value);
+        }
+    }
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        std::lock_guard lock{mutex_};
+        for (const Slot& slot : slots_) {
+            fn(*slot.value);
+        }
+    }
+
+private:
+    struct Slot {
+        std::thread::id thread;
+        std::unique_ptr<T> value;
+    };
+
+    static std::uint64_t NextId() noexcept {
+        static std::atomic<std::uint64_t> next_id{1};
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    T& FindOrCreate() {
+        const auto thread = std::this_thread::get_id();
+        std::lock_guard lock{mutex_};
+        for (Slot& slot : slots_) {
+            if (slot.thread == thread) {
+                return *slot.value;
+            }
+        }
+        return *slots_.emplace_back(Slot{thread, std::make_unique<T>()}).value;
+    }
+
+    const std::uint64_t id_ = NextId();
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+};
+
+}  // namespace util
@@ -0,0 +1,124 @@
+#include "tracing.h"
+
+#ifdef GAME_SERVER_TRACING
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace tracing {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point START = Clock::now();
+
+// Сколько последних событий хранит каждый поток
+constexpr std::size_t BUFFER_CAPACITY = 1 << 16;
+
+// Буфер событий одного потока. Мьютекс захватывает другой поток только при выгрузке трассы,
+// поэтому в остальное время он не блокирует запись
+struct ThreadBuffer {
+    explicit ThreadBuffer(unsigned thread_id)
+        : thread_id(thread_id)
+        , events(BUFFER_CAPACITY) {
+    }
+
+    const unsigned thread_id;
+    std::mutex mutex;
+    std::vector<Event> events;
+    // Сколько событий записано за всё время
+    std::uint64_t recorded = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Буферы переживают свои потоки, чтобы их события попали в трассу
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Registry& GetRegistry() {
+    // Не разрушается при выходе, поэтому потоки могут писать события до самого конца
+    static auto* registry = new Registry;
+    return *registry;
+}
+
+ThreadBuffer& GetThreadBuffer() {
+    thread_local ThreadBuffer* buffer = [] {
+        Registry& registry = GetRegistry();
+        std::lock_guard lock{registry.mutex};
+        const auto thread_id = static_cast<unsigned>(registry.buffers.size() + 1);
+        return registry.buffers.emplace_back(std::make_unique<ThreadBuffer>(thread_id)).get();
+    }();
+    return *buffer;
+}
+
+void WriteEvent(std::FILE* out, const Event& event, unsigned thread_id) {
+    std::fprintf(out, "{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", event.name,
+                 static_cast<char>(event.phase), thread_id, event.timestamp_ns / 1000.0);
+    if (event.phase == Phase::kComplete) {
+        std::fprintf(out, ",\"dur\":%.3f}", event.duration_ns / 1000.0);
+    } else {
+        std::fprintf(out, ",\"id\":\"0x%llx\"}", static_cast<unsigned long long>(event.id));
+    }
+}
+
+}  // namespace
+
+std::int64_t Now() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - START).count();
+}
+
+void Record(const Event& event) noexcept {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard lock{buffer.mutex};
+    buffer.events[buffer.recorded % BUFFER_CAPACITY] = event;
+    ++buffer.recorded;
+}
+
+std::size_t WriteChromeTrace(const std::string& path) {
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> out{std::fopen(path.c_str(), "w"), &std::fclose};
+    if (!out) {
+        throw std::runtime_error("Failed to open trace file " + path);
+    }
+    std::vector<ThreadBuffer*> buffers;
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard lock{registry.mutex};
+        for (const auto& buffer : registry.buffers) {
+            buffers.push_back(buffer.get());
+        }
+    }
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", out.get());
+    std::size_t count = 0;
+    std::vector<Event> events;
+    for (ThreadBuffer* buffer : buffers) {
+        // События копируются под мьютексом, а в файл пишутся без него, не задерживая поток
+        {
+            std::lock_guard lock{buffer->mutex};
+            const std::uint64_t first =
+                buffer->recorded > BUFFER_CAPACITY ? buffer->recorded - BUFFER_CAPACITY : 0;
+            events.clear();
+            for (std::uint64_t i = first; i < buffer->recorded; ++i) {
+                events.push_back(buffer->events[i % BUFFER_CAPACITY]);
+            }
+        }
+        std::fprintf(out.get(), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                                "\"args\":{\"name\":\"thread %u\"}}",
+                     buffer == buffers.front() ? "" : ",\n", buffer->thread_id, buffer->thread_id);
+        for (const Event& event : events) {
+            std::fputs(",\n", out.get());
+            WriteEvent(out.get(), event, buffer->thread_id);
+        }
+        count += events.size();
+    }
+    std::fputs("\n]}\n", out.get());
+    return count;
+}
+
+}  // namespace tracing
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+// Трассировка обработки запросов в формате Chrome trace (chrome://tracing, ui.perfetto.dev).
+// В отличие от perf, трасса показывает асинхронные границы: сколько запрос ждал чтения,
+// очереди ответов и записи в сокет. Включается при сборке опцией GAME_SERVER_TRACING;
+// без неё макросы TRACE_* раскрываются в пустой оператор, а их аргументы не вычисляются.
+//
+// События пишутся в кольцевой буфер своего потока, при переполнении старые события
+// затираются новыми. WriteChromeTrace выгружает буферы всех потоков по запросу.
+// name всегда должен быть строковым литералом: в буфере хранится только указатель
+
+#ifdef GAME_SERVER_TRACING
+#include <cstdint>
+#include <string>
+
+namespace tracing {
+
+enum class Phase : char {
+    kComplete = 'X',
+    kAsyncBegin = 'b',
+    kAsyncEnd = 'e',
+};
+
+struct Event {
+    const char* name;
+    std::int64_t timestamp_ns;
+    std::int64_t duration_ns;
+    // Связывает начало и конец асинхронного события
+    std::uint64_t id;
+    Phase phase;
+};
+
+// Наносекунды от запуска процесса
+std::int64_t Now() noexcept;
+
+// Добавляет событие в буфер текущего потока
+void Record(const Event& event) noexcept;
+
+// Записывает события всех потоков в файл path. Буферы при этом не очищаются.
+// Возвращает число записанных событий. Бросает std::runtime_error, если файл не открылся
+std::size_t WriteChromeTrace(const std::string& path);
+
+// Синхронный участок кода: событие записывается при выходе из области видимости
+class Scope {
+public:
+    explicit Scope(const char* name) noexcept
+        : name_(name)
+        , start_(Now()) {
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope() {
+        Record({name_, start_, Now() - start_, 0, Phase::kComplete});
+    }
+
+private:
+    const char* name_;
+    std::int64_t start_;
+};
+
+inline void AsyncBegin(const char* name, const void* id) noexcept {
+    Record({name, Now(), 0, reinterpret_cast<std::uintptr_t>(id), Phase::kAsyncBegin});
+}
+
+inline void AsyncEnd(const char* name, const void* id) noexcept {
+    Record({name, Now(), 0, reinterpret_cast<std::uintptr_t>(id), Phase::kAsyncEnd});
+}
+
+}  // namespace tracing
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+// Участок кода до конца текущего блока
+#define TRACE_SCOPE(name) ::tracing::Scope TRACE_CONCAT(trace_scope_, __LINE__){name}
+// Начало и конец асинхронной операции. id - адрес объекта, однозначно задающего операцию
+#define TRACE_ASYNC_BEGIN(name, id) ::tracing::AsyncBegin(name, id)
+#define TRACE_ASYNC_END(name, id) ::tracing::AsyncEnd(name, id)
+
+#else
+
+#define TRACE_SCOPE(name) static_cast<void>(0)
+#define TRACE_ASYNC_BEGIN(name, id) static_cast<void>(0)
+#define TRACE_ASYNC_END(name, id) static_cast<void>(0)
+
+#endif
@@ -0,0 +1,80 @@
+// Декодер двоичного представления ответов API (application/x-game-binary).
+// Формат описан в src/binary_encoding.h. Результат имеет тот же вид, что и JSON-ответ
+const BINARY_CONTENT_TYPE = 'application/x-game-binary';
+
+class BinaryReader {
+  constructor(buffer) {
+    this.view = new DataView(buffer);
+    this.bytes = new Uint8Array(buffer);
+    this.offset = 0;
+  }
+
+  byte() {
+    return this.view.getUint8(this.offset++);
+  }
+
+  varint() {
+    let result = 0;
+    let multiplier = 1;
+    for (;;) {
+      const b = this.byte();
+      result += (b & 0x7f) * multiplier;
+      if ((b & 0x80) === 0) {
+        return result;
+      }
+      multiplier *= 128;
+    }
+  }
+
+  int32() {
+    const value = this.view.getInt32(this.offset, true);
+    this.offset += 4;
+    return value;
+  }
+
+  string() {
+    const length = this.varint();
+    const value = new TextDecoder().decode(this.bytes.subarray(this.offset, this.offset + length));
+    this.offset += length;
+    return value;
+  }
+}
+
+function decodeBinaryMap(buffer) {
+  const r = new BinaryReader(buffer);
+  const magic = String.fromCharCode(r.byte(), r.byte(), r.byte(), r.byte());
+  const version = r.byte();
+  if (magic !== 'GMAP' || version !== 1) {
+    throw new Error('Unsupported map format: ' + magic + ' v' + version);
+  }
+  const map = {id: r.string(), name: r.string(), roads: [], buildings: [], offices: []};
+
+  for (let n = r.varint(); n > 0; --n) {
+    const vertical = r.byte() === 1;
+    const road = {x0: r.int32(), y0: r.int32()};
+    road[vertical ? 'y1' : 'x1'] = r.int32();
+    map.roads.push(road);
+  }
+  for (let n = r.varint(); n > 0; --n) {
+    map.buildings.push({x: r.int32(), y: r.int32(), w: r.int32(), h: r.int32()});
+  }
+  for (let n = r.varint(); n > 0; --n) {
+    map.offices.push({id: r.string(), x: r.int32(), y: r.int32(), offsetX: r.int32(), offsetY: r.int32()});
+  }
+  return map;
+}
+
+// Запрашивает карту в двоичном виде. Если сервер ответил JSON, разбирает его
+function fetchMap(id) {
+  return fetch('/api/v1/maps/' + encodeURIComponent(id), {
+    headers: {'Accept': BINARY_CONTENT_TYPE + ', application/json;q=0.9'}
+  }).then(response => {
+    if (!response.ok) {
+      throw new Error('Failed to load map ' + id + ': ' + response.status);
+    }
+    if ((response.headers.get('Content-Type') || '').startsWith(BINARY_CONTENT_TYPE)) {
+      return response.arrayBuffer().then(decodeBinaryMap);
+    }
+    return response.json();
+  });
+}
@@ -0,0 +1,204 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/binary_encoding.h"
+
+using namespace std::literals;
+namespace {
+
+// Читает формат, описанный в binary_encoding.h, независимо от кодировщика
+class Reader {
+public:
+    explicit Reader(std::string_view data)
+        : data_(data) {
+    }
+
+    unsigned char Byte() {
+        if (data_.empty()) {
+            throw std::out_of_range("unexpected end of data");
+        }
+        const auto value = static_cast<unsigned char>(data_.front());
+        data_.remove_prefix(1);
+        return value;
+    }
+
+    std::uint64_t Varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            const unsigned char byte = Byte();
+            value |= std::uint64_t{byte & 0x7fu} << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+    }
+
+    std::int32_t Int32() {
+        std::uint32_t bits = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            bits |= std::uint32_t{Byte()} << shift;
+        }
+        return static_cast<std::int32_t>(bits);
+    }
+
+    std::string String() {
+        return Raw(Varint());
+    }
+
+    std::string Raw(std::size_t size) {
+        if (data_.size() < size) {
+            throw std::out_of_range("unexpected end of data");
+        }
+        std::string value{data_.substr(0, size)};
+        data_.remove_prefix(size);
+        return value;
+    }
+
+    bool AtEnd() const noexcept {
+        return data_.empty();
+    }
+
+private:
+    std::string_view data_;
+};
+
+struct DecodedRoad {
+    bool vertical;
+    std::int32_t x0, y0, end;
+};
+
+struct DecodedOffice {
+    std::string id;
+    std::int32_t x, y, dx, dy;
+};
+
+struct DecodedMap {
+    std::string id;
+    std::string name;
+    std::vector<DecodedRoad> roads;
+    std::vector<model::Rectangle> buildings;
+    std::vector<DecodedOffice> offices;
+};
+
+DecodedMap DecodeMap(std::string_view data) {
+    Reader reader{data};
+    REQUIRE(reader.Raw(4) == "GMAP");
+    REQUIRE(reader.Byte() == binary_encoding::FORMAT_VERSION);
+    DecodedMap map;
+    map.id = reader.String();
+    map.name = reader.String();
+    for (auto count = reader.Varint(); count > 0; --count) {
+        const bool vertical = reader.Byte() == 1;
+        const auto x0 = reader.Int32();
+        const auto y0 = reader.Int32();
+        map.roads.push_back({vertical, x0, y0, reader.Int32()});
+    }
+    for (auto count = reader.Varint(); count > 0; --count) {
+        const auto x = reader.Int32();
+        const auto y = reader.Int32();
+        const auto w = reader.Int32();
+        map.buildings.push_back({{x, y}, {w, reader.Int32()}});
+    }
+    for (auto count = reader.Varint(); count > 0; --count) {
+        DecodedOffice office;
+        office.id = reader.String();
+        office.x = reader.Int32();
+        office.y = reader.Int32();
+        office.dx = reader.Int32();
+        office.dy = reader.Int32();
+        map.offices.push_back(std::move(office));
+    }
+    CHECK(reader.AtEnd());
+    return map;
+}
+
+}  // namespace
+
+SCENARIO("Binary map encoding round-trips") {
+    GIVEN("a map with negative coordinates, a UTF-8 name and enough roads for a multi-byte count") {
+        // 300 дорог: число записывается двумя байтами varint
+        constexpr int ROADS = 300;
+        model::Map map{model::Map::Id{"town"s}, "Городок"s};
+        for (int i = 0; i < ROADS; ++i) {
+            if (i % 2 == 0) {
+                map.AddRoad({model::Road::HORIZONTAL, {-i, i * 1000}, 70'000});
+            } else {
+                map.AddRoad({model::Road::VERTICAL, {i, -2'000'000'000}, 2'000'000'000});
+            }
+        }
+        map.AddBuilding(model::Building{{{5, -5}, {30, 20}}});
+        map.AddOffice({model::Office::Id{"o0"s}, {40, 30}, {5, -1}});
+
+        WHEN("it is encoded and decoded") {
+            const DecodedMap decoded = DecodeMap(binary_encoding::EncodeMap(map));
+
+            THEN("every field is restored") {
+                CHECK(decoded.id == "town");
+                CHECK(decoded.name == "Городок");
+                REQUIRE(decoded.roads.size() == ROADS);
+                for (int i = 0; i < ROADS; ++i) {
+                    const model::Road& road = map.GetRoads()[i];
+                    const DecodedRoad& result = decoded.roads[i];
+                    CHECK(result.vertical == road.IsVertical());
+                    CHECK(result.x0 == road.GetStart().x);
+                    CHECK(result.y0 == road.GetStart().y);
+                    CHECK(result.end == (road.IsVertical() ? road.GetEnd().y : road.GetEnd().x));
+                }
+                REQUIRE(decoded.buildings.size() == 1);
+                CHECK(decoded.buildings[0].position.x == 5);
+                CHECK(decoded.buildings[0].position.y == -5);
+                CHECK(decoded.buildings[0].size.width == 30);
+                CHECK(decoded.buildings[0].size.height == 20);
+                REQUIRE(decoded.offices.size() == 1);
+                CHECK(decoded.offices[0].id == "o0");
+                CHECK(decoded.offices[0].x == 40);
+                CHECK(decoded.offices[0].y == 30);
+                CHECK(decoded.offices[0].dx == 5);
+                CHECK(decoded.offices[0].dy == -1);
+            }
+        }
+    }
+
+    GIVEN("an empty map") {
+        const model::Map map{model::Map::Id{""s}, ""s};
+
+        THEN("it decodes to empty fields and lists") {
+            const DecodedMap decoded = DecodeMap(binary_encoding::EncodeMap(map));
+            CHECK(decoded.id.empty());
+            CHECK(decoded.name.empty());
+            CHECK(decoded.roads.empty());
+            CHECK(decoded.buildings.empty());
+            CHECK(decoded.offices.empty());
+        }
+    }
+}
+
+SCENARIO("Binary encoding is negotiated with the Accept header") {
+    WHEN("the binary type is requested explicitly") {
+        THEN("it is preferred unless JSON has a higher q") {
+            CHECK(binary_encoding::PrefersBinary("application/x-game-binary"sv));
+            CHECK(binary_encoding::PrefersBinary("application/x-game-binary, application/json;q=0.9"sv));
+            CHECK(binary_encoding::PrefersBinary("Application/X-Game-Binary;q=0.5, */*;q=0.5"sv));
+            CHECK_FALSE(binary_encoding::PrefersBinary("application/x-game-binary;q=0.5, application/json"sv));
+        }
+    }
+    WHEN("q follows other media type parameters") {
+        THEN("it is still honoured") {
+            CHECK_FALSE(binary_encoding::PrefersBinary("application/x-game-binary;v=1;q=0"sv));
+            CHECK_FALSE(binary_encoding::PrefersBinary("application/x-game-binary; v=1 ; q=0.1, application/json"sv));
+            CHECK(binary_encoding::PrefersBinary("application/json;v=2;q=0.2, application/x-game-binary;v=1"sv));
+        }
+    }
+    WHEN("the binary type is not named") {
+        THEN("JSON is used") {
+            CHECK_FALSE(binary_encoding::PrefersBinary(""sv));
+            CHECK_FALSE(binary_encoding::PrefersBinary("*/*"sv));
+            CHECK_FALSE(binary_encoding::PrefersBinary("application/json"sv));
+        }
+    }
+}
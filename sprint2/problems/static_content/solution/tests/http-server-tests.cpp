@@ -0,0 +1,387 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "../src/http_server.h"
+#include "../src/json_loader.h"
+#include "../src/request_handler.h"
+
+using namespace std::literals;
+namespace {
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using tcp = net::ip::tcp;
+
+// Выделения памяти в потоке сервера. Клиент теста работает в другом потоке и не учитывается
+std::atomic<std::size_t> server_allocations{0};
+thread_local bool is_server_thread = false;
+
+void* CountedAllocate(std::size_t size) {
+    if (is_server_thread) {
+        server_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    return CountedAllocate(size);
+}
+void* operator new[](std::size_t size) {
+    return CountedAllocate(size);
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+// Отвечает на любой запрос, не выделяя память: заголовки размещаются в арене сессии,
+// а тело ссылается на статическую строку
+struct StaticResponseHandler {
+    static constexpr std::string_view BODY = "OK"sv;
+
+    template <typename Request, typename Send>
+    void operator()(Request&& req, Send&& send) const {
+        using Fields = typename std::decay_t<Request>::fields_type;
+        http::response<http::span_body<const char>, Fields> response{
+            std::piecewise_construct, std::make_tuple(), std::make_tuple(req.get_allocator())};
+        response.result(http::status::ok);
+        response.version(req.version());
+        response.set(http::field::content_type, "text/plain"sv);
+        response.body() = {BODY.data(), BODY.size()};
+        response.prepare_payload();
+        response.keep_alive(req.keep_alive());
+        send(std::move(response));
+    }
+};
+
+// Отвечает телом, которое начинается с target запроса. Ответы на нечётные target длинные,
+// поэтому пишутся дольше, чем читаются следующие запросы конвейера
+struct EchoTargetHandler {
+    static constexpr std::size_t LONG_BODY_SIZE = 256 * 1024;
+
+    template <typename Request, typename Send>
+    void operator()(Request&& req, Send&& send) const {
+        std::string body{req.target()};
+        if ((body.back() - '0') % 2 == 1) {
+            body.resize(LONG_BODY_SIZE, '.');
+        }
+        http::response<http::string_body> response{http::status::ok, req.version()};
+        response.set(http::field::content_type, "text/plain"sv);
+        response.body() = std::move(body);
+        response.prepare_payload();
+        response.keep_alive(req.keep_alive());
+        send(std::move(response));
+    }
+};
+
+// Отправляет запрос и дочитывает ответ до конца тела
+void Exchange(tcp::socket& client) {
+    static constexpr std::string_view REQUEST = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"sv;
+    static constexpr std::string_view RESPONSE_END = "\r\n\r\nOK"sv;
+    net::write(client, net::buffer(REQUEST));
+    std::array<char, 1024> response;
+    std::size_t size = 0;
+    while (size < RESPONSE_END.size()
+           || std::string_view{response.data() + size - RESPONSE_END.size(), RESPONSE_END.size()} != RESPONSE_END) {
+        REQUIRE(size < response.size());
+        size += client.read_some(net::buffer(response.data() + size, response.size() - size));
+    }
+}
+
+// Отправляет GET-запрос target и читает ответ целиком. Выделения памяти клиентом не учитываются
+http::response<http::string_body> Get(tcp::socket& client, boost::beast::flat_buffer& buffer, std::string_view target) {
+    http::request<http::empty_body> request{http::verb::get, target, 11};
+    request.set(http::field::host, "localhost"sv);
+    http::write(client, request);
+    http::response<http::string_body> response;
+    http::read(client, buffer, response);
+    return response;
+}
+
+}  // namespace
+
+SCENARIO("Keep-alive requests do not allocate memory in the server") {
+    GIVEN("a server with a handler that does not allocate") {
+        net::io_context ioc{1};
+        auto connections = std::make_shared<http_server::ConnectionManager>();
+        auto metrics = std::make_shared<http_server::Metrics>();
+        auto listener = std::make_shared<http_server::Listener<StaticResponseHandler>>(
+            ioc, tcp::endpoint{net::ip::address_v4::loopback(), 0}, StaticResponseHandler{}, connections, metrics);
+        listener->Run();
+        std::thread server([&ioc] {
+            is_server_thread = true;
+            ioc.run();
+        });
+
+        net::io_context client_ioc;
+        tcp::socket client{client_ioc};
+        client.connect(listener->GetLocalEndpoint());
+
+        WHEN("the session is warmed up") {
+            // Первые запросы заполняют кэши аллокаторов, арену и буфер сессии
+            constexpr int WARM_UP_REQUESTS = 100;
+            for (int i = 0; i < WARM_UP_REQUESTS; ++i) {
+                Exchange(client);
+            }
+
+            THEN("further requests perform no heap allocations on the server thread") {
+                constexpr int MEASURED_REQUESTS = 1000;
+                const std::size_t allocations_before = server_allocations.load();
+                for (int i = 0; i < MEASURED_REQUESTS; ++i) {
+                    Exchange(client);
+                }
+                CHECK(server_allocations.load() == allocations_before);
+            }
+        }
+
+        client.close();
+        ioc.stop();
+        server.join();
+    }
+}
+
+SCENARIO("Pipelined requests are answered in order") {
+    GIVEN("a server whose responses differ in size") {
+        net::io_context ioc{1};
+        auto connections = std::make_shared<http_server::ConnectionManager>();
+        auto metrics = std::make_shared<http_server::Metrics>();
+        auto listener = std::make_shared<http_server::Listener<EchoTargetHandler>>(
+            ioc, tcp::endpoint{net::ip::address_v4::loopback(), 0}, EchoTargetHandler{}, connections, metrics);
+        listener->Run();
+        std::thread server([&ioc] {
+            ioc.run();
+        });
+
+        net::io_context client_ioc;
+        tcp::socket client{client_ioc};
+        client.connect(listener->GetLocalEndpoint());
+
+        WHEN("more requests than the response queue holds are sent in one write") {
+            // Больше, чем MAX_QUEUED_RESPONSES: сессия приостановит чтение, пока очередь занята
+            constexpr int REQUESTS = 20;
+            std::string requests;
+            for (int i = 0; i < REQUESTS; ++i) {
+                requests += "GET /"s + std::to_string(i) + " HTTP/1.1\r\nHost: localhost\r\n\r\n"s;
+            }
+            net::write(client, net::buffer(requests));
+
+            THEN("the responses come back in the order of the requests") {
+                boost::beast::flat_buffer buffer;
+                for (int i = 0; i < REQUESTS; ++i) {
+                    http::response<http::string_body> response;
+                    http::read(client, buffer, response);
+                    const std::string target = "/"s + std::to_string(i);
+                    CHECK(response.body().substr(0, target.size()) == target);
+                    CHECK(response.body().size() == (i % 2 == 1 ? EchoTargetHandler::LONG_BODY_SIZE : target.size()));
+                }
+            }
+        }
+
+        client.close();
+        ioc.stop();
+        server.join();
+    }
+}
+
+SCENARIO("Draining finishes in-flight requests and refuses new connections") {
+    GIVEN("a server with a busy and an idle keep-alive connection") {
+        net::io_context ioc{1};
+        auto connections = std::make_shared<http_server::ConnectionManager>();
+        auto metrics = std::make_shared<http_server::Metrics>();
+        auto listener = std::make_shared<http_server::Listener<StaticResponseHandler>>(
+            ioc, tcp::endpoint{net::ip::address_v4::loopback(), 0}, StaticResponseHandler{}, connections, metrics);
+        listener->Run();
+        const auto endpoint = listener->GetLocalEndpoint();
+        std::thread server([&ioc] {
+            ioc.run();
+        });
+
+        net::io_context client_ioc;
+        tcp::socket busy{client_ioc};
+        busy.connect(endpoint);
+        tcp::socket idle{client_ioc};
+        idle.connect(endpoint);
+        // После обмена соединения точно приняты сервером
+        Exchange(busy);
+        Exchange(idle);
+        // Запрос, который сервер начал читать до остановки
+        net::write(busy, net::buffer("GET / HTTP/1.1\r\nHost: localhost\r\n"sv));
+
+        WHEN("the server starts draining") {
+            std::promise<void> drain_started;
+            std::promise<void> drained;
+            net::post(ioc, [&] {
+                connections->Drain(ioc, 5s, [&drained] {
+                    drained.set_value();
+                });
+                // Выполнится после того, как акцептор и сессии получат уведомление
+                net::post(ioc, [&drain_started] {
+                    drain_started.set_value();
+                });
+            });
+            drain_started.get_future().wait();
+
+            THEN("new connections are refused") {
+                tcp::socket late{client_ioc};
+                boost::system::error_code ec;
+                late.connect(endpoint, ec);
+                CHECK(ec == net::error::connection_refused);
+            }
+
+            THEN("the idle connection is closed") {
+                std::array<char, 16> buffer;
+                boost::system::error_code ec;
+                idle.read_some(net::buffer(buffer), ec);
+                CHECK(ec == net::error::eof);
+            }
+
+            THEN("the in-flight request is answered and its connection closed") {
+                net::write(busy, net::buffer("\r\n"sv));
+                boost::beast::flat_buffer buffer;
+                http::response<http::string_body> response;
+                http::read(busy, buffer, response);
+                CHECK(response.result() == http::status::ok);
+                CHECK(response.body() == StaticResponseHandler::BODY);
+                CHECK_FALSE(response.keep_alive());
+
+                boost::system::error_code ec;
+                http::read(busy, buffer, response, ec);
+                CHECK(ec == http::error::end_of_stream);
+
+                AND_THEN("draining completes once no sessions remain") {
+                    idle.close();
+                    CHECK(drained.get_future().wait_for(5s) == std::future_status::ready);
+                }
+            }
+        }
+
+        busy.close();
+        idle.close();
+        ioc.stop();
+        server.join();
+    }
+}
+
+SCENARIO("A per-core server is drained and destroyed") {
+    GIVEN("a server with an io_context per thread") {
+        auto pool = std::make_unique<http_server::IoContextPool>(http_server::IoContextPool::Mode::kPerCore, 2);
+        auto connections = std::make_shared<http_server::ConnectionManager>();
+        http_server::ServeHttp(*pool, tcp::endpoint{net::ip::address_v4::loopback(), 0}, StaticResponseHandler{},
+                               connections, std::make_shared<http_server::Metrics>());
+
+        WHEN("the server is drained, stopped and its timers are shut down") {
+            bool drained = false;
+            net::post(pool->GetContext(0), [&] {
+                connections->Drain(pool->GetContext(0), 5s, [&] {
+                    drained = true;
+                    pool->Stop();
+                });
+            });
+            pool->Run();
+            connections->Shutdown();
+
+            THEN("the io_contexts can be destroyed before the last reference to the manager") {
+                CHECK(drained);
+                // Сессии и акцепторы в пулах io_context держат ссылки на ConnectionManager,
+                // и последняя из них освобождается при разрушении одного из io_context
+                connections.reset();
+                pool.reset();
+            }
+        }
+    }
+}
+
+SCENARIO("Keep-alive requests to the request handler allocate a bounded amount of memory") {
+    GIVEN("a server with the game request handler") {
+        namespace fs = std::filesystem;
+        const fs::path root = fs::temp_directory_path() / ("http_server_tests_" + std::to_string(::getpid()));
+        fs::create_directories(root / "static");
+        std::ofstream(root / "config.json")
+            << R"({"maps":[{"id":"map1","name":"Map 1","roads":[{"x0":0,"y0":0,"x1":40}],)"
+               R"("buildings":[],"offices":[]}]})";
+        std::ofstream(root / "static" / "index.html") << "<!DOCTYPE html><html><body>Game</body></html>";
+
+        auto game = json_loader::LoadGame(root / "config.json");
+        const auto& names = http_handler::RequestHandler::ROUTE_NAMES;
+        auto metrics = std::make_shared<http_server::Metrics>(std::vector<std::string>(names.begin(), names.end()));
+        http_handler::RequestHandler handler{game, *metrics, (root / "static").string()};
+
+        net::io_context ioc{1};
+        auto connections = std::make_shared<http_server::ConnectionManager>();
+        auto handle = [&handler](auto&& req, auto&& send) {
+            handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
+        };
+        auto listener = std::make_shared<http_server::Listener<decltype(handle)>>(
+            ioc, tcp::endpoint{net::ip::address_v4::loopback(), 0}, handle, connections, metrics);
+        listener->Run();
+        std::thread server([&ioc] {
+            is_server_thread = true;
+            ioc.run();
+        });
+
+        net::io_context client_ioc;
+        tcp::socket client{client_ioc};
+        client.connect(listener->GetLocalEndpoint());
+        boost::beast::flat_buffer buffer;
+
+        // Допустимое число выделений на запрос. Ответ об ошибке собирает тело в std::string
+        const std::vector<std::pair<std::string_view, std::size_t>> targets{
+            {"/api/v1/maps"sv, 0}, {"/api/v1/maps/map1"sv, 0}, {"/index.html"sv, 0}, {"/api/v1/maps/none"sv, 2}};
+        for (const auto& [target, allocations_per_request] : targets) {
+            WHEN(std::string(target) + " is requested on a warmed-up session") {
+                constexpr int WARM_UP_REQUESTS = 100;
+                for (int i = 0; i < WARM_UP_REQUESTS; ++i) {
+                    Get(client, buffer, target);
+                }
+
+                THEN("the server thread allocates no more than the handler itself needs") {
+                    constexpr int MEASURED_REQUESTS = 1000;
+                    const std::size_t allocations_before = server_allocations.load();
+                    for (int i = 0; i < MEASURED_REQUESTS; ++i) {
+                        Get(client, buffer, target);
+                    }
+                    // Кэш блоков обработчиков изредка пополняется ещё раз, когда отменённое ожидание
+                    // таймера не успело завершиться к его перезапуску
+                    constexpr std::size_t CACHE_GROWTH = 4;
+                    CHECK(server_allocations.load() - allocations_before
+                          <= MEASURED_REQUESTS * allocations_per_request + CACHE_GROWTH);
+                }
+            }
+        }
+
+        client.close();
+        ioc.stop();
+        server.join();
+        std::error_code ignored;
+        fs::remove_all(root, ignored);
+    }
+}
@@ -0,0 +1,142 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/loadgen/ammo.h"
+#include "../src/loadgen/schedule.h"
+
+using namespace std::literals;
+
+namespace {
+
+std::vector<loadgen::AmmoRequest> Load(const std::string& text) {
+    std::istringstream input{text};
+    return loadgen::LoadAmmo(input, "localhost:8080"sv);
+}
+
+bool IsNear(double actual, double expected) {
+    return std::abs(actual - expected) < 1e-9;
+}
+
+}  // namespace
+
+SCENARIO("Ammo file is parsed into serialized requests") {
+    GIVEN("an ammo file with headers, tags, blank lines and CRLF line ends") {
+        const auto requests = Load(
+            "[Connection: keep-alive]\r\n"
+            "\r\n"
+            "/api/v1/maps maps\r\n"
+            "[accept: application/json]\n"
+            "[Connection: close]\n"
+            "  /api/v1/maps/map1\t  map \n"s);
+
+        THEN("every uri line becomes a GET request with the headers seen before it") {
+            REQUIRE(requests.size() == 2);
+            CHECK(requests[0].uri == "/api/v1/maps"s);
+            CHECK(requests[0].tag == "maps"s);
+            CHECK(requests[0].data ==
+                  "GET /api/v1/maps HTTP/1.1\r\n"
+                  "Connection: keep-alive\r\n"
+                  "Host: localhost:8080\r\n"
+                  "\r\n"s);
+        }
+        THEN("a repeated header replaces the earlier value regardless of case") {
+            REQUIRE(requests.size() == 2);
+            CHECK(requests[1].uri == "/api/v1/maps/map1"s);
+            CHECK(requests[1].tag == "map"s);
+            CHECK(requests[1].data ==
+                  "GET /api/v1/maps/map1 HTTP/1.1\r\n"
+                  "Connection: close\r\n"
+                  "accept: application/json\r\n"
+                  "Host: localhost:8080\r\n"
+                  "\r\n"s);
+        }
+    }
+    GIVEN("an ammo file with its own Host header") {
+        const auto requests = Load("[host: example.com]\n/\n"s);
+
+        THEN("the default host is not added") {
+            REQUIRE(requests.size() == 1);
+            CHECK(requests[0].tag.empty());
+            CHECK(requests[0].data == "GET / HTTP/1.1\r\nhost: example.com\r\n\r\n"s);
+        }
+    }
+    GIVEN("invalid ammo files") {
+        THEN("a file without requests is rejected") {
+            CHECK_THROWS_AS(Load(""s), std::invalid_argument);
+            CHECK_THROWS_AS(Load("[Host: example.com]\n\n"s), std::invalid_argument);
+        }
+        THEN("a header without a colon is rejected") {
+            CHECK_THROWS_AS(Load("[Connection]\n/\n"s), std::invalid_argument);
+        }
+    }
+}
+
+SCENARIO("Load schedule is parsed from phantom syntax") {
+    WHEN("durations are given with different units") {
+        THEN("they are converted to seconds") {
+            CHECK(IsNear(loadgen::Schedule::Parse("const(1, 500ms)"sv).GetDuration(), 0.5));
+            CHECK(IsNear(loadgen::Schedule::Parse("const(1, 2)"sv).GetDuration(), 2));
+            CHECK(IsNear(loadgen::Schedule::Parse("const(1, 3s)"sv).GetDuration(), 3));
+            CHECK(IsNear(loadgen::Schedule::Parse("const(1, 1.5m)"sv).GetDuration(), 90));
+            CHECK(IsNear(loadgen::Schedule::Parse("const(1, 1h)"sv).GetDuration(), 3600));
+            CHECK(IsNear(loadgen::Schedule::Parse(" line(1, 5, 1m)  const( 5 , 30s ) "sv).GetDuration(), 90));
+        }
+    }
+    WHEN("the schedule is invalid") {
+        THEN("Parse throws") {
+            for (const auto text : {""sv, "   "sv, "const(1)"sv, "line(1, 2)"sv, "const(-1, 1s)"sv,
+                                    "const(1, 1x)"sv, "const(a, 1s)"sv, "step(1, 1s)"sv, "const(1, 1s"sv,
+                                    "const)1, 1s("sv}) {
+                INFO(text);
+                CHECK_THROWS_AS(loadgen::Schedule::Parse(text), std::invalid_argument);
+            }
+        }
+    }
+}
+
+SCENARIO("Load schedule computes request counts and send times") {
+    GIVEN("a ramp from 0 to 10 rps over 2 s followed by 10 rps for 1 s") {
+        const auto schedule = loadgen::Schedule::Parse("line(0, 10, 2s) const(10, 1s)"sv);
+
+        THEN("CountAt integrates the rate") {
+            CHECK(IsNear(schedule.GetDuration(), 3));
+            CHECK(IsNear(schedule.CountAt(-1), 0));
+            CHECK(IsNear(schedule.CountAt(0), 0));
+            CHECK(IsNear(schedule.CountAt(1), 2.5));
+            CHECK(IsNear(schedule.CountAt(2), 10));
+            CHECK(IsNear(schedule.CountAt(2.5), 15));
+            CHECK(IsNear(schedule.CountAt(3), 20));
+            CHECK(IsNear(schedule.CountAt(10), 20));
+        }
+        THEN("TimeOf returns the moment each request is due") {
+            CHECK(IsNear(schedule.TimeOf(0), 0));
+            CHECK(IsNear(schedule.TimeOf(2.5), 1));
+            CHECK(IsNear(schedule.TimeOf(10), 2));
+            CHECK(IsNear(schedule.TimeOf(15), 2.5));
+        }
+        THEN("TimeOf inverts CountAt within the profile") {
+            for (double t = 0.05; t < 3; t += 0.05) {
+                INFO(t);
+                CHECK(std::abs(schedule.TimeOf(schedule.CountAt(t)) - t) < 1e-6);
+            }
+        }
+        THEN("requests past the end of the profile are never due") {
+            CHECK(std::isinf(schedule.TimeOf(20)));
+            CHECK(std::isinf(schedule.TimeOf(1e9)));
+        }
+    }
+    GIVEN("a descending ramp and a zero-length step") {
+        const auto schedule = loadgen::Schedule::Parse("const(100, 0s) line(10, 0, 2s)"sv);
+
+        THEN("the zero-length step sends nothing and the ramp ends after 10 requests") {
+            CHECK(IsNear(schedule.CountAt(2), 10));
+            CHECK(IsNear(schedule.TimeOf(0), 0));
+            CHECK(IsNear(schedule.TimeOf(schedule.CountAt(1)), 1));
+            CHECK(std::isinf(schedule.TimeOf(10)));
+        }
+    }
+}
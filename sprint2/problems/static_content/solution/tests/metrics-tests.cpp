@@ -0,0 +1,79 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/metrics.h"
+
+using namespace std::literals;
+namespace {
+
+using http_server::Metrics;
+
+// Строка счётчика ответов 2xx маршрута UNKNOWN_ROUTE в выводе Render. Без имён маршруты называются по номерам
+std::string OkResponses(std::uint64_t count) {
+    return "http_responses_total{route=\"0\",code=\"2xx\"} " + std::to_string(count) + "\n";
+}
+
+}  // namespace
+
+SCENARIO("Each Metrics object keeps its own per-thread counters") {
+    GIVEN("two metrics objects used alternately by one thread") {
+        Metrics first;
+        Metrics second;
+
+        WHEN("responses are recorded in both") {
+            first.RecordResponse(http_server::UNKNOWN_ROUTE, 200, 10, 20);
+            second.RecordResponse(http_server::UNKNOWN_ROUTE, 200, 10, 20);
+            first.RecordResponse(http_server::UNKNOWN_ROUTE, 200, 10, 20);
+
+            THEN("each object counts only its own responses") {
+                CHECK(first.Render().find(OkResponses(2)) != std::string::npos);
+                CHECK(second.Render().find(OkResponses(1)) != std::string::npos);
+            }
+        }
+    }
+
+    GIVEN("a metrics object created in place of a destroyed one") {
+        std::optional<Metrics> metrics;
+        metrics.emplace();
+        metrics->RecordResponse(http_server::UNKNOWN_ROUTE, 200, 10, 20);
+        metrics.reset();
+        // Новый объект занимает тот же адрес, но не должен получить блок прежнего
+        metrics.emplace();
+
+        WHEN("a response is recorded") {
+            metrics->RecordResponse(http_server::UNKNOWN_ROUTE, 200, 10, 20);
+
+            THEN("only the new response is counted") {
+                CHECK(metrics->Render().find(OkResponses(1)) != std::string::npos);
+            }
+        }
+    }
+
+    GIVEN("a metrics object written by several threads") {
+        Metrics metrics;
+        constexpr int THREADS = 4;
+        constexpr int RESPONSES_PER_THREAD = 1000;
+
+        WHEN("every thread records responses") {
+            std::vector<std::thread> threads;
+            for (int i = 0; i < THREADS; ++i) {
+                threads.emplace_back([&metrics] {
+                    for (int j = 0; j < RESPONSES_PER_THREAD; ++j) {
+                        metrics.RecordResponse(http_server::UNKNOWN_ROUTE, 200, 10, 20);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            THEN("the counters of all threads are summed") {
+                CHECK(metrics.Render().find(OkResponses(THREADS * RESPONSES_PER_THREAD)) != std::string::npos);
+            }
+        }
+    }
+}
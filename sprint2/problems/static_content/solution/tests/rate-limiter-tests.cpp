@@ -0,0 +1,102 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+
+#include "../src/rate_limiter.h"
+
+using namespace std::literals;
+namespace {
+
+using http_handler::RateLimiter;
+using Clock = RateLimiter::Clock;
+
+constexpr std::size_t ROUTE = 0;
+
+// Момент, далёкий от эпохи часов, чтобы пустая корзина считалась давно наполнившейся
+const Clock::time_point START = Clock::time_point{} + 24h;
+
+std::uint64_t Key(const char* address) {
+    return RateLimiter::HashAddress(boost::asio::ip::make_address(address));
+}
+
+// Сколько запросов подряд корзина пропускает в момент now
+int CountAllowed(RateLimiter& limiter, std::uint64_t key, Clock::time_point now) {
+    int allowed = 0;
+    while (limiter.TryAcquire(ROUTE, key, now).allowed) {
+        ++allowed;
+    }
+    return allowed;
+}
+
+}  // namespace
+
+SCENARIO("Rate limiter allows a burst and then the average rate") {
+    GIVEN("a limit of 10 requests per second with a burst of 3") {
+        RateLimiter limiter{{{10, 3}}};
+        const auto key = Key("192.0.2.1");
+
+        THEN("an idle client may send the whole burst at once") {
+            CHECK(CountAllowed(limiter, key, START) == 3);
+        }
+        WHEN("the burst is spent") {
+            REQUIRE(CountAllowed(limiter, key, START) == 3);
+
+            THEN("the next request is rejected until a token is refilled") {
+                const auto decision = limiter.TryAcquire(ROUTE, key, START + 30ms);
+                CHECK_FALSE(decision.allowed);
+                CHECK(decision.retry_after == 70ms);
+            }
+            THEN("one token is refilled per interval") {
+                CHECK(CountAllowed(limiter, key, START + 99ms) == 0);
+                CHECK(CountAllowed(limiter, key, START + 100ms) == 1);
+                CHECK(CountAllowed(limiter, key, START + 250ms) == 1);
+                CHECK(CountAllowed(limiter, key, START + 500ms) == 3);
+            }
+            THEN("idle time refills no more than the burst") {
+                CHECK(CountAllowed(limiter, key, START + 1h) == 3);
+            }
+            THEN("other clients keep their own buckets") {
+                CHECK(CountAllowed(limiter, Key("192.0.2.2"), START) == 3);
+                CHECK(CountAllowed(limiter, Key("2001:db8::1"), START) == 3);
+            }
+        }
+    }
+    GIVEN("a limit without a burst") {
+        RateLimiter limiter{{{0.5, 1}}};
+        const auto key = Key("192.0.2.1");
+
+        THEN("requests are spaced by the whole interval") {
+            REQUIRE(limiter.TryAcquire(ROUTE, key, START).allowed);
+            const auto decision = limiter.TryAcquire(ROUTE, key, START + 500ms);
+            CHECK_FALSE(decision.allowed);
+            CHECK(decision.retry_after == 1500ms);
+            CHECK(limiter.TryAcquire(ROUTE, key, START + 2s).allowed);
+        }
+    }
+}
+
+SCENARIO("Routes without a limit are not restricted") {
+    GIVEN("a limiter with a limit on the second route only") {
+        RateLimiter limiter{{{0, 1}, {1, 1}}};
+        const auto key = Key("192.0.2.1");
+
+        THEN("only the limited route reports a limit") {
+            CHECK_FALSE(limiter.IsLimited(0));
+            CHECK(limiter.IsLimited(1));
+            CHECK_FALSE(limiter.IsLimited(2));
+        }
+        THEN("requests to other routes are always allowed") {
+            for (int i = 0; i < 100; ++i) {
+                CHECK(limiter.TryAcquire(0, key, START).allowed);
+                CHECK(limiter.TryAcquire(2, key, START).allowed);
+            }
+        }
+    }
+    GIVEN("limits so small that the interval would overflow") {
+        RateLimiter limiter{{{1e-300, 1e300}}};
+
+        THEN("the limiter still works") {
+            CHECK(limiter.TryAcquire(0, Key("192.0.2.1"), START).allowed);
+        }
+    }
+}
@@ -0,0 +1,235 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/json_loader.h"
+#include "../src/metrics.h"
+#include "../src/request_context.h"
+#include "../src/request_handler.h"
+
+using namespace std::literals;
+namespace {
+
+namespace fs = std::filesystem;
+namespace http = boost::beast::http;
+using http_handler::RequestHandler;
+using http_handler::StaticCache;
+
+void WriteFile(const fs::path& path, std::string_view content) {
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+constexpr std::string_view CONFIG =
+    R"({"maps":[{"id":"map1","name":"Map 1","roads":[{"x0":0,"y0":0,"x1":40}],)"
+    R"("buildings":[],"offices":[]}]})";
+constexpr std::string_view INDEX_HTML = "<!DOCTYPE html><html><body>Game</body></html>";
+
+// Игра и каталог статики во временной папке, удаляемой по окончании теста
+struct Environment {
+    Environment()
+        : root(fs::temp_directory_path() / ("request_handler_tests_" + std::to_string(::getpid())))
+        , game(Load(root))
+        , metrics(std::vector<std::string>(RequestHandler::ROUTE_NAMES.begin(), RequestHandler::ROUTE_NAMES.end())) {
+    }
+
+    ~Environment() {
+        std::error_code ignored;
+        fs::remove_all(root, ignored);
+    }
+
+    static model::Game Load(const fs::path& root) {
+        fs::create_directories(root / "static");
+        WriteFile(root / "config.json", CONFIG);
+        WriteFile(root / "static" / "index.html", INDEX_HTML);
+        return json_loader::LoadGame(root / "config.json");
+    }
+
+    std::string StaticPath() const {
+        return (root / "static").string();
+    }
+
+    fs::path root;
+    model::Game game;
+    http_server::Metrics metrics;
+};
+
+// Ответ, сохранённый в виде, не зависящем от типа тела
+struct Response {
+    unsigned status = 0;
+    std::string etag;
+    std::string allow;
+    std::string retry_after;
+    std::string body;
+};
+
+struct CapturingSend {
+    template <typename ResponseType>
+    void operator()(ResponseType&& response) {
+        captured.status = response.result_int();
+        captured.etag = std::string(response[http::field::etag]);
+        captured.allow = std::string(response[http::field::allow]);
+        captured.retry_after = std::string(response[http::field::retry_after]);
+        if constexpr (std::is_same_v<typename std::decay_t<ResponseType>::body_type, http::string_body>) {
+            captured.body = response.body();
+        }
+    }
+
+    Response& captured;
+};
+
+http::request<http::string_body> MakeRequest(http::verb method, std::string_view target) {
+    http::request<http::string_body> request{method, target, 11};
+    request.set(http::field::host, "localhost:8080"sv);
+    return request;
+}
+
+Response Execute(RequestHandler& handler, http::request<http::string_body> request) {
+    Response response;
+    handler(std::move(request), CapturingSend{response});
+    return response;
+}
+
+http::request<http::string_body> MakeJoinRequest(std::string_view token) {
+    auto request = MakeRequest(http::verb::post, "/api/v1/game/join");
+    request.set(http::field::authorization, "Bearer "s + std::string(token));
+    request.set(http::field::content_type, "application/json"sv);
+    request.body() = R"({"userName":"Scooby Doo","mapId":"map1"})";
+    request.prepare_payload();
+    return request;
+}
+
+// Ограничения, в которых задан только маршрут route
+std::vector<http_handler::RateLimit> LimitRoute(RequestHandler::Route route, http_handler::RateLimit limit) {
+    std::vector<http_handler::RateLimit> limits(RequestHandler::ROUTE_NAMES.size());
+    limits[static_cast<std::size_t>(route)] = limit;
+    return limits;
+}
+
+}  // namespace
+
+SCENARIO("Static files are revalidated with If-None-Match") {
+    GIVEN("a handler serving a cached static file") {
+        Environment environment;
+        RequestHandler handler{environment.game, environment.metrics, environment.StaticPath()};
+
+        const Response first = Execute(handler, MakeRequest(http::verb::get, "/index.html"));
+        REQUIRE(first.status == 200);
+        REQUIRE_FALSE(first.etag.empty());
+
+        WHEN("the client repeats the request with the ETag it received") {
+            auto request = MakeRequest(http::verb::get, "/index.html");
+            request.set(http::field::if_none_match, first.etag);
+            const Response response = Execute(handler, std::move(request));
+
+            THEN("the server answers 304 Not Modified with the same ETag") {
+                CHECK(response.status == 304);
+                CHECK(response.etag == first.etag);
+            }
+        }
+
+        WHEN("the client sends a stale ETag") {
+            auto request = MakeRequest(http::verb::get, "/index.html");
+            request.set(http::field::if_none_match, "\"stale\"");
+            const Response response = Execute(handler, std::move(request));
+
+            THEN("the full file is sent") {
+                CHECK(response.status == 200);
+            }
+        }
+    }
+}
+
+SCENARIO("API requests with a wrong method get 405 with Allow") {
+    GIVEN("a request handler") {
+        Environment environment;
+        RequestHandler handler{environment.game, environment.metrics};
+
+        WHEN("a known API path is requested with a method it does not support") {
+            const Response response = Execute(handler, MakeRequest(http::verb::post, "/api/v1/maps"));
+
+            THEN("the response is 405 and lists the supported methods") {
+                CHECK(response.status == 405);
+                CHECK(response.allow == "GET");
+                CHECK(response.body == R"({"code":"invalidMethod","message":"Invalid method"})");
+            }
+        }
+
+        WHEN("an unknown API path is requested") {
+            const Response response = Execute(handler, MakeRequest(http::verb::get, "/api/v1/unknown"));
+
+            THEN("the response is 400") {
+                CHECK(response.status == 400);
+            }
+        }
+    }
+}
+
+SCENARIO("Requests are rate limited by client address") {
+    GIVEN("a handler allowing a burst of 2 join requests and almost no refill") {
+        Environment environment;
+        RequestHandler handler{environment.game, environment.metrics, "", StaticCache::DEFAULT_MAX_BYTES,
+                               LimitRoute(RequestHandler::Route::kJoinGame, {0.001, 2})};
+        http_server::SetRequestRemoteAddress(boost::asio::ip::make_address("192.0.2.1"));
+
+        WHEN("a client sends a new Bearer token with every request") {
+            const Response first = Execute(handler, MakeJoinRequest("00000000000000000000000000000001"));
+            const Response second = Execute(handler, MakeJoinRequest("00000000000000000000000000000002"));
+            const Response third = Execute(handler, MakeJoinRequest("00000000000000000000000000000003"));
+
+            THEN("rotating tokens does not reset the limit") {
+                CHECK(first.status != 429);
+                CHECK(second.status != 429);
+                CHECK(third.status == 429);
+                CHECK(third.body == R"({"code":"tooManyRequests","message":"Too many requests"})");
+            }
+            THEN("Retry-After is the whole number of seconds until the next token, rounded up") {
+                REQUIRE(third.status == 429);
+                CHECK(third.retry_after == "1000");
+            }
+        }
+
+        WHEN("the limit of one address is exhausted") {
+            for (int i = 0; i < 3; ++i) {
+                Execute(handler, MakeJoinRequest("00000000000000000000000000000001"));
+            }
+            http_server::SetRequestRemoteAddress(boost::asio::ip::make_address("2001:db8::1"));
+            const Response other = Execute(handler, MakeJoinRequest("00000000000000000000000000000001"));
+
+            THEN("another address is still served") {
+                CHECK(other.status != 429);
+            }
+        }
+
+        WHEN("a route without a limit is requested") {
+            THEN("it is never rejected") {
+                for (int i = 0; i < 10; ++i) {
+                    CHECK(Execute(handler, MakeRequest(http::verb::get, "/api/v1/maps")).status == 200);
+                }
+            }
+        }
+    }
+    GIVEN("a handler allowing 10 map requests per second without a burst") {
+        Environment environment;
+        RequestHandler handler{environment.game, environment.metrics, "", StaticCache::DEFAULT_MAX_BYTES,
+                               LimitRoute(RequestHandler::Route::kMap, {10, 1})};
+        http_server::SetRequestRemoteAddress(boost::asio::ip::make_address("192.0.2.2"));
+
+        WHEN("the second request comes before the next token") {
+            const Response first = Execute(handler, MakeRequest(http::verb::get, "/api/v1/maps/map1"));
+            const Response second = Execute(handler, MakeRequest(http::verb::get, "/api/v1/maps/map1"));
+
+            THEN("Retry-After is at least one second") {
+                CHECK(first.status == 200);
+                REQUIRE(second.status == 429);
+                CHECK(second.retry_after == "1");
+            }
+        }
+    }
+}
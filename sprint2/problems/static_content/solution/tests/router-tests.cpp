@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string_view>
+
+#include "../src/router.h"
+
+using namespace std::literals;
+namespace {
+
+namespace http = boost::beast::http;
+
+enum class Endpoint { kMaps, kMap, kPlayers, kJoin, kPlayer };
+using TestRouter = http_handler::Router<Endpoint, 6>;
+using MatchKind = TestRouter::MatchKind;
+
+constexpr TestRouter ROUTER{{{
+    {"/api/v1/maps"sv, MatchKind::kExact, http::verb::get, Endpoint::kMaps},
+    {"/api/v1/maps/"sv, MatchKind::kPrefix, http::verb::get, Endpoint::kMap},
+    {"/api/v1/game/players"sv, MatchKind::kExact, http::verb::get, Endpoint::kPlayers},
+    {"/api/v1/game/players"sv, MatchKind::kExact, http::verb::head, Endpoint::kPlayers},
+    {"/api/v1/game/join"sv, MatchKind::kExact, http::verb::post, Endpoint::kJoin},
+    {"/api/v1/game/players/"sv, MatchKind::kPrefix, http::verb::delete_, Endpoint::kPlayer},
+}}};
+
+// Таблица строится на этапе компиляции
+static_assert(ROUTER.Find(http::verb::get, "/api/v1/maps"sv).route->endpoint == Endpoint::kMaps);
+
+}  // namespace
+
+SCENARIO("Router matches exact and prefix routes") {
+    WHEN("an exact path is requested") {
+        const auto match = ROUTER.Find(http::verb::get, "/api/v1/maps"sv);
+        THEN("the exact route is found without a parameter") {
+            REQUIRE(match.route);
+            CHECK(match.route->endpoint == Endpoint::kMaps);
+            CHECK(match.param.empty());
+        }
+    }
+    WHEN("a path under a prefix is requested") {
+        const auto match = ROUTER.Find(http::verb::get, "/api/v1/maps/map1"sv);
+        THEN("the rest of the path is the parameter") {
+            REQUIRE(match.route);
+            CHECK(match.route->endpoint == Endpoint::kMap);
+            CHECK(match.param == "map1"sv);
+        }
+    }
+    WHEN("the parameter is empty or contains slashes") {
+        const auto empty = ROUTER.Find(http::verb::get, "/api/v1/maps/"sv);
+        const auto nested = ROUTER.Find(http::verb::get, "/api/v1/maps/a/b"sv);
+        THEN("the prefix route still matches") {
+            REQUIRE(empty.route);
+            CHECK(empty.param.empty());
+            REQUIRE(nested.route);
+            CHECK(nested.param == "a/b"sv);
+        }
+    }
+    WHEN("the target has a query string") {
+        const auto exact = ROUTER.Find(http::verb::get, "/api/v1/maps?page=2"sv);
+        const auto prefix = ROUTER.Find(http::verb::get, "/api/v1/maps/map1?format=json"sv);
+        THEN("the query string is ignored") {
+            REQUIRE(exact.route);
+            CHECK(exact.route->endpoint == Endpoint::kMaps);
+            REQUIRE(prefix.route);
+            CHECK(prefix.param == "map1"sv);
+        }
+    }
+}
+
+SCENARIO("Router reports unknown paths and methods") {
+    WHEN("the path is not registered") {
+        THEN("nothing is found and no methods are allowed") {
+            for (const auto target : {"/api/v1/unknown"sv, "/api/v1/map"sv, "/api/v1/mapsx"sv, ""sv, "/"sv}) {
+                const auto match = ROUTER.Find(http::verb::get, target);
+                CHECK(match.route == nullptr);
+                CHECK(match.allowed == 0);
+            }
+        }
+    }
+    WHEN("one path is registered for several methods") {
+        const auto get = ROUTER.Find(http::verb::get, "/api/v1/game/players"sv);
+        const auto head = ROUTER.Find(http::verb::head, "/api/v1/game/players"sv);
+        THEN("each method finds its own route") {
+            REQUIRE(get.route);
+            CHECK(get.route->method == http::verb::get);
+            REQUIRE(head.route);
+            CHECK(head.route->method == http::verb::head);
+        }
+    }
+    WHEN("the path is known but the method is not") {
+        const auto match = ROUTER.Find(http::verb::post, "/api/v1/game/players"sv);
+        THEN("the allowed methods of the path are reported") {
+            CHECK(match.route == nullptr);
+            CHECK(match.allowed == (TestRouter::VerbBit(http::verb::get) | TestRouter::VerbBit(http::verb::head)));
+        }
+    }
+    WHEN("an exact and a prefix route share the beginning of the path") {
+        const auto exact = ROUTER.Find(http::verb::delete_, "/api/v1/game/players"sv);
+        const auto prefix = ROUTER.Find(http::verb::delete_, "/api/v1/game/players/42"sv);
+        THEN("only routes of the matching kind are considered") {
+            CHECK(exact.route == nullptr);
+            CHECK(exact.allowed == (TestRouter::VerbBit(http::verb::get) | TestRouter::VerbBit(http::verb::head)));
+            REQUIRE(prefix.route);
+            CHECK(prefix.route->endpoint == Endpoint::kPlayer);
+            CHECK(prefix.param == "42"sv);
+        }
+    }
+}
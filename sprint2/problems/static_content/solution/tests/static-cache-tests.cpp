@@ -0,0 +1,173 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+#include "../src/static_cache.h"
+
+using namespace std::literals;
+namespace {
+
+namespace fs = std::filesystem;
+using http_handler::StaticCache;
+
+void WriteFile(const fs::path& path, std::string_view content) {
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+// Каталог статики во временной папке, удаляемый по окончании теста
+struct TempDirectory {
+    explicit TempDirectory(std::string_view name)
+        : path(fs::temp_directory_path() / (std::string(name) + "_" + std::to_string(::getpid()))) {
+        fs::create_directories(path);
+    }
+
+    ~TempDirectory() {
+        std::error_code ignored;
+        fs::remove_all(path, ignored);
+    }
+
+    fs::path path;
+};
+
+// Текст, который сжимается примерно вдвое: случайные строчные буквы и пробелы
+std::string MakeText(std::size_t size, unsigned seed) {
+    std::string text;
+    text.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const unsigned letter = (seed >> 16) % 27;
+        text += letter == 26 ? ' ' : static_cast<char>('a' + letter);
+    }
+    return text;
+}
+
+}  // namespace
+
+SCENARIO("Static cache evicts least recently used files and reloads them") {
+    GIVEN("a cache whose content budget holds two of three files") {
+        TempDirectory root{"static_cache_tests"};
+        // Файлы .bin не сжимаются, поэтому весь лимит содержимого - три четверти max_bytes
+        constexpr std::size_t FILE_SIZE = 400;
+        constexpr std::size_t MAX_BYTES = 1100;
+        WriteFile(root.path / "a.bin", std::string(FILE_SIZE, 'a'));
+        WriteFile(root.path / "b.bin", std::string(FILE_SIZE, 'b'));
+        WriteFile(root.path / "c.bin", std::string(FILE_SIZE, 'c'));
+        // Больше лимита содержимого: кеш не учитывает его вовсе
+        WriteFile(root.path / "huge.bin", std::string(MAX_BYTES, 'h'));
+        StaticCache cache{root.path, MAX_BYTES};
+
+        const auto* a = cache.Find("a.bin");
+        const auto* b = cache.Find("b.bin");
+        const auto* c = cache.Find("c.bin");
+        REQUIRE(a);
+        REQUIRE(b);
+        REQUIRE(c);
+
+        THEN("files larger than the content budget are skipped at startup") {
+            CHECK(cache.Find("huge.bin") == nullptr);
+        }
+
+        WHEN("a file beyond the budget is requested") {
+            const auto body_a = cache.GetBody(*a);
+            const auto body_b = cache.GetBody(*b);
+            const auto body_c = cache.GetBody(*c);
+            REQUIRE(body_c);
+            CHECK(*body_c == std::string(FILE_SIZE, 'c'));
+
+            THEN("the least recently used file is evicted and reloaded from disk on demand") {
+                // a запрашивался раньше b, поэтому вытеснен он
+                CHECK(cache.GetBody(*b) == body_b);
+                const auto reloaded_a = cache.GetBody(*a);
+                REQUIRE(reloaded_a);
+                CHECK(reloaded_a != body_a);
+                CHECK(*reloaded_a == *body_a);
+            }
+
+            AND_WHEN("the evicted file changes on disk") {
+                WriteFile(root.path / "a.bin", std::string(FILE_SIZE, 'x'));
+
+                THEN("the cache refuses to serve it under the startup ETag") {
+                    CHECK(cache.GetBody(*a) == nullptr);
+                }
+                THEN("the file is no longer found and is not read again") {
+                    REQUIRE(cache.GetBody(*a) == nullptr);
+                    CHECK(cache.Find("a.bin") == nullptr);
+                    // Возврат прежнего содержимого не оживляет запись: кеш не перечитывает файл
+                    WriteFile(root.path / "a.bin", std::string(FILE_SIZE, 'a'));
+                    CHECK(cache.GetBody(*a) == nullptr);
+                    CHECK(cache.Find("a.bin") == nullptr);
+                    CHECK(cache.Find("b.bin") == b);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Compressed representations stay within their own budget") {
+    GIVEN("text files whose compressed forms exceed a quarter of the limit") {
+        TempDirectory root{"static_cache_encoding_tests"};
+        constexpr std::size_t FILE_SIZE = 8000;
+        constexpr std::size_t MAX_BYTES = 20000;
+        WriteFile(root.path / "one.html", MakeText(FILE_SIZE, 1));
+        WriteFile(root.path / "two.html", MakeText(FILE_SIZE, 2));
+        StaticCache cache{root.path, MAX_BYTES};
+
+        THEN("representations that do not fit are not created") {
+            std::size_t encoded_bytes = 0;
+            std::size_t representations = 0;
+            for (const auto* name : {"one.html", "two.html"}) {
+                const auto* asset = cache.Find(name);
+                REQUIRE(asset);
+                for (const auto& encoded : asset->encoded) {
+                    encoded_bytes += encoded.body->size();
+                    ++representations;
+                }
+            }
+            CHECK(encoded_bytes <= MAX_BYTES / 4);
+            CHECK(representations < 4);
+        }
+    }
+}
+
+SCENARIO("Compressed representation is chosen by Accept-Encoding") {
+    GIVEN("a text file with brotli and gzip representations") {
+        TempDirectory root{"static_cache_negotiation_tests"};
+        WriteFile(root.path / "index.html", std::string(4096, 'x'));
+        StaticCache cache{root.path};
+        const auto* asset = cache.Find("index.html");
+        REQUIRE(asset);
+        REQUIRE(asset->encoded.size() == 2);
+
+        const auto select = [asset](std::string_view accept_encoding) -> std::string_view {
+            const auto* encoded = StaticCache::SelectEncoding(*asset, accept_encoding);
+            return encoded ? encoded->encoding : "identity"sv;
+        };
+
+        THEN("brotli is preferred when both are equally acceptable") {
+            CHECK(select("gzip, deflate, br"sv) == "br"sv);
+        }
+        THEN("a higher q value wins") {
+            CHECK(select("br;q=0.5, gzip;q=0.8"sv) == "gzip"sv);
+        }
+        THEN("q is recognised after other parameters") {
+            CHECK(select("br;level=5;q=0, gzip"sv) == "gzip"sv);
+            CHECK(select("br; foo=bar ; Q=0.1, gzip;x=y;q=0.9"sv) == "gzip"sv);
+        }
+        THEN("q=0 and a zero wildcard disable compression") {
+            CHECK(select("br;q=0, gzip;q=0"sv) == "identity"sv);
+            CHECK(select("identity, *;q=0"sv) == "identity"sv);
+        }
+        THEN("unlisted encodings take the wildcard value") {
+            CHECK(select("*"sv) == "br"sv);
+            CHECK(select("br;q=0.2, *;q=0.6"sv) == "gzip"sv);
+        }
+        THEN("no header means no compression") {
+            CHECK(select(""sv) == "identity"sv);
+        }
+    }
+}